@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser {
+
+// Arguments split out of one command string. Words that need no unescaping
+// are views into the original text, which must outlive this object; only
+// words built from several quoted or escaped pieces are copied, into a
+// single buffer no larger than the text. Moving keeps every view valid.
+class command_line {
+public:
+	command_line() noexcept = default;
+	command_line(command_line &&) noexcept = default;
+	command_line &operator=(command_line &&) noexcept = default;
+	command_line(const command_line &) = delete;
+	command_line &operator=(const command_line &) = delete;
+
+	const std::vector<std::string_view> &args() const noexcept { return args_; }
+	std::size_t size() const noexcept { return args_.size(); }
+	std::string_view operator[](std::size_t i) const noexcept { return args_[i]; }
+
+	operator arg_list() const noexcept { return arg_list(args_); }
+
+	// Whether arg i lives in the copy buffer rather than the original text.
+	bool copied(std::size_t i) const noexcept;
+
+private:
+	friend command_line split_command(std::string_view text);
+
+	std::vector<std::string_view> args_;
+	std::unique_ptr<char[]> storage_;
+	std::size_t storage_size_ = 0;
+};
+
+// Splits text into words following POSIX shell quoting: blanks separate
+// words, single quotes are literal, double quotes honour backslash before
+// $ ` " \ and newline, an unquoted backslash escapes the next character,
+// backslash-newline joins lines and `#` at the start of a word comments out
+// the rest of the line. No expansion of any kind is performed. Throws
+// parse_error with error_code::bad_quoting and the byte offset of the
+// problem. Runs in one linear pass.
+command_line split_command(std::string_view text);
+
+} // namespace option_parser
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "option_parser/command_line.hpp"
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser {
+
+// One immutable, validated parse together with the text its values view,
+// so it stays valid for as long as anyone holds it. config_watcher builds
+// them from files; make() from arguments held in memory.
+class config {
+public:
+	// Parses args, which the config keeps, and validates the result; throws
+	// its parse_error or limit_error.
+	static std::shared_ptr<const config> make(const spec &options, std::vector<std::string> args,
+	                                          std::uint64_t generation = 1, const parse_limits &limits = {});
+
+	// Values view arguments held inside the config, so it neither copies
+	// nor moves; share it through the shared_ptr make() returns.
+	config(const config &) = delete;
+	config(config &&) = delete;
+	config &operator=(const config &) = delete;
+	config &operator=(config &&) = delete;
+
+	const result &values() const noexcept { return values_; }
+	// Counts the configs published in turn; config_watcher starts at 1.
+	std::uint64_t generation() const noexcept { return generation_; }
+
+private:
+	friend class config_watcher;
+
+	// One file's arguments, split and tokenized apart from the others so a
+	// config can reuse them when other files change.
+	struct source {
+		std::string text;
+		command_line words;        // views text, which stays put on the heap
+		std::vector<token> tokens; // indices number words alone
+	};
+
+	// Splits text as by split_command and tokenizes it; throws as tokenize.
+	static std::shared_ptr<const source> read(const spec &options, std::string text, const parse_limits &limits);
+
+	// Applies the tokens of sources, then parses arguments after them.
+	config(const spec &options, std::vector<std::shared_ptr<const source>> sources, std::vector<std::string> arguments,
+	       std::uint64_t generation, const parse_limits &limits);
+	result parse_all(const spec &options, const parse_limits &limits) const;
+
+	// Shared with the configs before and after it for files that did not change.
+	std::vector<std::shared_ptr<const source>> sources_;
+	std::vector<std::string> arguments_;
+	std::vector<std::string_view> args_; // views of arguments_
+	std::uint64_t generation_;
+	result values_;
+};
+
+} // namespace option_parser
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "option_parser/config.hpp"
+#include "option_parser/option_parser.hpp"
+#include "option_parser/published_config.hpp"
+#include "option_parser/response_file.hpp"
+
+namespace option_parser {
+
+struct watch_options {
+	// A reload waits until the files have been quiet this long, so a burst
+	// of writes, or an editor's write-and-rename, is read once.
+	std::chrono::milliseconds debounce{50};
+	// Apply to the files taken together, as to one argument list, except
+	// max_response_bytes, which bounds each file read.
+	parse_limits limits;
+	file_loader load = read_file;
+	// Reader threads the watcher's published_config has slots for.
+	std::size_t max_readers = published_config::default_max_readers;
+	// Called on the watching thread after a reload is published, with the
+	// config it replaced; a change_notifier can publish the two.
+	std::function<void(const std::shared_ptr<const config> &before, const std::shared_ptr<const config> &after)>
+	    on_publish;
+	// Called on the watching thread when a reload fails; the previous config
+	// stays current. Without it poll() throws the error, and start()'s thread
+	// drops it. The files that failed are read again only with the next
+	// inotify event for any watched file; nothing retries them on a timer.
+	std::function<void(std::exception_ptr error)> on_error;
+};
+
+// Watches config files with inotify and republishes their parse when they
+// change. Each file holds arguments split as by split_command; the files
+// are parsed as one argument list in the order given, so later files
+// override earlier ones, except that each file is tokenized on its own: an
+// option's value must be in the same file, and `--` ends option processing
+// only to the end of its file. Response files named inside them are not
+// expanded. A reload re-reads and re-tokenizes only the files that had
+// events and whose bytes changed, reusing the tokens of the rest, and
+// applies and validates them all before publishing, so readers never see
+// a config that would fail to read.
+//
+// Configs are published through a published_config, which reader threads
+// read wait-free through a published_config::reader of their own.
+// current() may be called from any thread but takes a lock, so it suits
+// occasional reads rather than hot paths. poll() must be called from one
+// thread at a time, and not while the watcher runs its own thread.
+class config_watcher {
+public:
+	// Loads and parses every file and publishes the first config. Throws
+	// parse_error (error_code::response_file for an unreadable file) or
+	// limit_error as parse would, and std::system_error if inotify fails.
+	config_watcher(const spec &options, std::vector<std::string> paths, watch_options settings = {});
+	~config_watcher();
+
+	config_watcher(const config_watcher &) = delete;
+	config_watcher &operator=(const config_watcher &) = delete;
+
+	// For wait-free reads: published_config::reader reader(watcher.published());
+	// every reader must be destroyed before the watcher.
+	published_config &published() noexcept { return *published_; }
+	std::shared_ptr<const config> current() const { return published_->current(); }
+
+	// Waits up to timeout for changes, then for the debounce period to pass
+	// without events, and reloads. Returns whether a new config was published.
+	bool poll(std::chrono::milliseconds timeout);
+
+	// Runs poll() on a thread of the watcher's own until stop() or
+	// destruction. Throws std::logic_error if already running.
+	void start();
+	void stop();
+
+private:
+	struct directory {
+		int wd;
+		std::string path;
+	};
+
+	std::string read_text(std::size_t i) const;
+	bool wait(std::chrono::milliseconds timeout) const;
+	void drain();
+	bool reload();
+
+	const spec *spec_;
+	std::vector<std::string> paths_;
+	std::vector<std::size_t> directory_of_; // per path
+	std::vector<std::string> names_;        // per path, relative to its directory
+	std::vector<directory> directories_;
+	std::vector<bool> dirty_;
+	watch_options settings_;
+	int inotify_ = -1;
+	int wake_[2] = {-1, -1}; // a pipe stop() writes to, to end a wait early
+	std::optional<published_config> published_; // set once the first config is loaded
+	std::thread thread_;
+	std::atomic<bool> stopping_{false};
+};
+
+} // namespace option_parser
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser {
+
+// Ids of the options whose values differ between two results, ascending.
+class change_set {
+public:
+	const std::vector<option_id> &ids() const noexcept { return ids_; }
+	std::size_t size() const noexcept { return ids_.size(); }
+	bool empty() const noexcept { return ids_.empty(); }
+	bool contains(option_id id) const noexcept;
+
+	const option_id *begin() const noexcept { return ids_.data(); }
+	const option_id *end() const noexcept { return ids_.data() + ids_.size(); }
+
+private:
+	friend change_set diff(const result &before, const result &after);
+
+	std::vector<option_id> ids_;
+};
+
+// Compares two results of the same spec option by option, in one pass over
+// their flat value arrays, by value rather than by how it was given: an
+// option set to its default is unchanged, flags compare their counts,
+// lists their values in order and maps their entries in any order. Values
+// are converted as reading them would, so this throws the parse_error of a
+// value that does not convert; validated results never throw. Throws
+// std::invalid_argument for results of different specs.
+change_set diff(const result &before, const result &after);
+
+// Per-option callbacks for hot reload. A subscriber names the options it
+// depends on, singly or as a group, and is called once per publish() in
+// which any of them changed, in the order subscribers were added.
+// Callbacks may subscribe and unsubscribe; subscribers added during a
+// publish() are first called by the next one, but may not publish
+// themselves. Not synchronized: subscribe
+// and publish from one thread, or under a lock.
+class change_notifier {
+public:
+	using callback = std::function<void(const result &current, const change_set &changes)>;
+	using subscription = std::size_t;
+
+	subscription subscribe(option_id id, callback fn);
+	subscription subscribe(std::vector<option_id> ids, callback fn);
+	// Every option in group and below it, as of now.
+	subscription subscribe(const option_group &group, callback fn);
+	// Drops a subscriber; unknown or already dropped ones are ignored.
+	void unsubscribe(subscription which) noexcept;
+
+	// Diffs before and after and calls the subscribers of what changed
+	// with after. An exception from a callback propagates and skips the
+	// subscribers after it. Returns the change set. Throws std::logic_error
+	// when called from one of its own callbacks.
+	change_set publish(const result &before, const result &after);
+
+private:
+	struct subscriber {
+		callback fn;
+		std::vector<option_id> ids;
+		bool active = true;
+	};
+
+	std::deque<subscriber> subscribers_; // stable while callbacks add more
+	std::vector<std::vector<subscription>> by_option_; // subscribers per option id
+	bool publishing_ = false; // callbacks of dropped subscribers are released after
+};
+
+} // namespace option_parser
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace option_parser {
+
+// Open-addressing hash map from string_view to string_view. Entries are kept
+// densely in insertion order and a power-of-two table of 32-bit indices is
+// probed linearly, so a map costs two allocations no matter how many keys it
+// holds. Keys are hashed with a randomly keyed SipHash, so crafted keys
+// cannot force long probe runs. Keys and values are not copied; whatever
+// they view must outlive the map.
+class flat_string_map {
+public:
+	struct entry {
+		std::string_view key;
+		std::string_view value;
+	};
+
+	// Makes room for n entries without rehashing.
+	void reserve(std::size_t n);
+
+	// Inserts key unless already present. Returns the entry for key and
+	// whether it was inserted; an existing entry is left unchanged.
+	std::pair<entry *, bool> insert(std::string_view key, std::string_view value);
+
+	const entry *find(std::string_view key) const noexcept;
+	bool contains(std::string_view key) const noexcept { return find(key) != nullptr; }
+
+	std::size_t size() const noexcept { return entries_.size(); }
+	bool empty() const noexcept { return entries_.empty(); }
+
+	const entry *begin() const noexcept { return entries_.data(); }
+	const entry *end() const noexcept { return entries_.data() + entries_.size(); }
+
+private:
+	static constexpr std::uint32_t empty_slot = 0;
+
+	std::size_t probe(std::string_view key) const noexcept;
+	void rehash(std::size_t buckets);
+
+	std::vector<entry> entries_;
+	std::vector<std::uint32_t> index_; // entry position + 1, or empty_slot
+};
+
+} // namespace option_parser
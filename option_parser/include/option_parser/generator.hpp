@@ -0,0 +1,101 @@
+#pragma once
+
+// Coroutine interface to pull_parser, available when the including
+// translation unit is compiled as C++20 with coroutine support. The library
+// itself stays C++17; code built as C++17 uses pull_parser's iterators.
+
+#include "option_parser/option_parser.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define OPTION_PARSER_HAS_COROUTINES 1
+
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+namespace option_parser {
+
+// Minimal single-pass generator: each resumption runs the coroutine to its
+// next co_yield. Exceptions thrown by the coroutine are rethrown from the
+// iterator increment (or begin()) that resumed it.
+template <typename T>
+class generator {
+public:
+	struct promise_type {
+		const T *current = nullptr;
+		std::exception_ptr error;
+
+		generator get_return_object() noexcept {
+			return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		std::suspend_always yield_value(const T &value) noexcept {
+			current = &value;
+			return {};
+		}
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { error = std::current_exception(); }
+	};
+
+	class iterator {
+	public:
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+
+		iterator() noexcept = default;
+		explicit iterator(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+		const T &operator*() const noexcept { return *handle_.promise().current; }
+		const T *operator->() const noexcept { return handle_.promise().current; }
+		iterator &operator++() {
+			resume(handle_);
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+		bool operator==(std::default_sentinel_t) const noexcept { return !handle_ || handle_.done(); }
+
+	private:
+		std::coroutine_handle<promise_type> handle_;
+	};
+
+	generator(generator &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+	generator &operator=(generator other) noexcept {
+		std::swap(handle_, other.handle_);
+		return *this;
+	}
+	~generator() {
+		if (handle_)
+			handle_.destroy();
+	}
+
+	iterator begin() {
+		resume(handle_);
+		return iterator(handle_);
+	}
+	std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+	explicit generator(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+
+	static void resume(std::coroutine_handle<promise_type> handle) {
+		handle.resume();
+		if (handle.promise().error)
+			std::rethrow_exception(std::exchange(handle.promise().error, {}));
+	}
+
+	std::coroutine_handle<promise_type> handle_;
+};
+
+// Yields the events of a parse on demand. Destroying the generator early
+// leaves the remaining arguments untouched.
+inline generator<parse_event> events(const spec &options, arg_list args) {
+	pull_parser parser(options, args);
+	parse_event event;
+	while (parser.next(event))
+		co_yield event;
+}
+
+} // namespace option_parser
+
+#endif
@@ -1,3 +1,1081 @@
 #pragma once
 
-int test();
\ No newline at end of file
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "option_parser/flat_string_map.hpp"
+
+namespace option_parser {
+
+using option_id = std::uint32_t;
+
+// How the value of an option is interpreted.
+enum class value_kind : std::uint8_t {
+	flag,     // takes no value; occurrences are counted
+	string,   // raw text, last occurrence wins
+	integer,  // signed 64-bit integer
+	floating, // double
+	choice,   // one name out of a fixed table, mapped to an enum value
+	list,     // raw text of every occurrence, in argument order
+	map,      // key=value pairs, optionally several per occurrence
+};
+
+// How the text given for a choice option is matched against the table.
+enum class choice_match : std::uint8_t {
+	exact,       // byte-wise equal
+	ignore_case, // equal after ASCII case folding
+	prefix,      // exact match, or the unique entry the text is a prefix of
+};
+
+// What a map option does when a key is given more than once.
+enum class duplicate_key : std::uint8_t {
+	last_wins,
+	first_wins,
+	reject, // raises parse_error with error_code::invalid_value
+};
+
+enum class error_code : std::uint8_t {
+	unknown_option,
+	missing_value,
+	unexpected_value,
+	invalid_value,
+	bad_quoting,   // split_command: unterminated quote or trailing backslash
+	response_file,  // unreadable
+	limit_exceeded, // a parse_limits bound was hit; thrown as limit_error
+	invalid_encoding, // an argument is not valid UTF-8 under spec::require_utf8
+};
+
+// Raised when the arguments do not conform to the spec. index() is the
+// position of the offending argument in the parsed list, or the byte offset
+// for errors found while splitting a command string.
+class parse_error : public std::runtime_error {
+public:
+	parse_error(error_code code, std::size_t index, const std::string &message);
+
+	error_code code() const noexcept { return code_; }
+	std::size_t index() const noexcept { return index_; }
+
+private:
+	error_code code_;
+	std::size_t index_;
+};
+
+// Hard bounds on the work and memory a single parse may take, for callers
+// that parse untrusted input. Every bound is checked before the memory it
+// protects is allocated. The defaults leave arguments unbounded and keep
+// response files to 16 levels and 16 MiB.
+struct parse_limits {
+	static constexpr std::size_t unlimited = static_cast<std::size_t>(-1);
+
+	std::size_t max_args = unlimited;                  // arguments, after response file expansion
+	std::size_t max_bytes = unlimited;                 // their total length
+	std::size_t max_values = unlimited;                // values of one list option, pairs of one map option
+	std::size_t max_response_depth = 16;               // nesting of @file inside @file
+	std::size_t max_response_bytes = 16 * 1024 * 1024; // response file contents read in total
+};
+
+enum class limit_kind : std::uint8_t {
+	args,
+	bytes,
+	values,
+	response_depth,
+	response_bytes,
+};
+
+// Raised with error_code::limit_exceeded when input exceeds a parse_limits
+// bound. which() names the bound and limit() its configured value.
+class limit_error : public parse_error {
+public:
+	limit_error(limit_kind which, std::size_t limit, std::size_t index, const std::string &message);
+
+	limit_kind which() const noexcept { return which_; }
+	std::size_t limit() const noexcept { return limit_; }
+
+private:
+	limit_kind which_;
+	std::size_t limit_;
+};
+
+namespace detail {
+
+constexpr char ascii_lower(char c) noexcept {
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Three-way comparison of the ASCII case folded forms of a and b.
+constexpr int compare_folded(std::string_view a, std::string_view b) noexcept {
+	const std::size_t n = a.size() < b.size() ? a.size() : b.size();
+	for (std::size_t i = 0; i < n; ++i) {
+		const auto ca = static_cast<unsigned char>(ascii_lower(a[i]));
+		const auto cb = static_cast<unsigned char>(ascii_lower(b[i]));
+		if (ca != cb)
+			return ca < cb ? -1 : 1;
+	}
+	if (a.size() == b.size())
+		return 0;
+	return a.size() < b.size() ? -1 : 1;
+}
+
+constexpr bool starts_with(std::string_view text, std::string_view prefix) noexcept {
+	return text.size() >= prefix.size() && text.substr(0, prefix.size()) == prefix;
+}
+
+constexpr bool starts_with_folded(std::string_view text, std::string_view prefix) noexcept {
+	return text.size() >= prefix.size() && compare_folded(text.substr(0, prefix.size()), prefix) == 0;
+}
+
+} // namespace detail
+
+// One name of a choice table with its enum value widened to int64.
+struct choice_entry {
+	std::string_view name;
+	std::int64_t value;
+};
+
+template <typename Enum>
+struct choice {
+	std::string_view name;
+	Enum value;
+};
+
+// Result of looking a text up in a choice table. candidates is 0 when
+// nothing matched and greater than 1 when a prefix was ambiguous.
+struct choice_lookup {
+	const choice_entry *entry;
+	std::size_t candidates;
+};
+
+// Looks text up in entries, which must be sorted by case folded name.
+// A single ordering serves every match mode: names equal under folding are
+// rejected when the table is built, so an exact or case-insensitive hit is
+// the lower bound itself, and all names sharing a folded prefix are adjacent.
+constexpr choice_lookup find_choice(const choice_entry *entries, std::size_t size, std::string_view text,
+                                    choice_match match) noexcept {
+	std::size_t lo = 0;
+	std::size_t hi = size;
+	while (lo < hi) {
+		const std::size_t mid = lo + (hi - lo) / 2;
+		if (detail::compare_folded(entries[mid].name, text) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < size && detail::compare_folded(entries[lo].name, text) == 0) {
+		if (match == choice_match::ignore_case || entries[lo].name == text)
+			return {&entries[lo], 1};
+	}
+	if (match != choice_match::prefix || text.empty())
+		return {nullptr, 0};
+
+	choice_lookup found{nullptr, 0};
+	for (std::size_t i = lo; i < size && detail::starts_with_folded(entries[i].name, text); ++i) {
+		if (!detail::starts_with(entries[i].name, text))
+			continue;
+		if (found.candidates++ == 0)
+			found.entry = &entries[i];
+		else
+			return {nullptr, found.candidates};
+	}
+	return found;
+}
+
+// Choice names sorted at compile time. Build one with make_choices so that
+// duplicate names are diagnosed while compiling:
+//
+//   constexpr auto modes = make_choices<mode>({{"fast", mode::fast}, {"safe", mode::safe}});
+template <typename Enum, std::size_t N>
+class choice_table {
+	static_assert(std::is_enum_v<Enum>, "choice tables map names to enum values");
+
+public:
+	constexpr explicit choice_table(const choice<Enum> (&choices)[N]) : entries_{} {
+		for (std::size_t i = 0; i < N; ++i) {
+			choice_entry entry{choices[i].name, static_cast<std::int64_t>(choices[i].value)};
+			std::size_t j = i;
+			for (; j > 0 && detail::compare_folded(entry.name, entries_[j - 1].name) < 0; --j)
+				entries_[j] = entries_[j - 1];
+			if (j > 0 && detail::compare_folded(entry.name, entries_[j - 1].name) == 0)
+				throw std::invalid_argument("choice names must be unique ignoring case");
+			entries_[j] = entry;
+		}
+	}
+
+	constexpr std::optional<Enum> find(std::string_view text, choice_match match = choice_match::exact) const noexcept {
+		const choice_lookup found = find_choice(entries_.data(), N, text, match);
+		if (found.entry == nullptr)
+			return std::nullopt;
+		return static_cast<Enum>(found.entry->value);
+	}
+
+	constexpr const std::array<choice_entry, N> &entries() const noexcept { return entries_; }
+	static constexpr std::size_t size() noexcept { return N; }
+
+private:
+	std::array<choice_entry, N> entries_;
+};
+
+template <typename Enum, std::size_t N>
+constexpr choice_table<Enum, N> make_choices(const choice<Enum> (&choices)[N]) {
+	return choice_table<Enum, N>(choices);
+}
+
+class string_pattern;
+class string_span;
+class change_set;
+
+namespace detail {
+
+template <typename T>
+constexpr value_kind kind_of() noexcept {
+	if constexpr (std::is_same_v<T, bool>)
+		return value_kind::flag;
+	else if constexpr (std::is_same_v<T, std::string_view>)
+		return value_kind::string;
+	else if constexpr (std::is_same_v<T, string_span>)
+		return value_kind::list;
+	else if constexpr (std::is_same_v<T, flat_string_map>)
+		return value_kind::map;
+	else if constexpr (std::is_enum_v<T>)
+		return value_kind::choice;
+	else if constexpr (std::is_integral_v<T>)
+		return value_kind::integer;
+	else {
+		static_assert(std::is_floating_point_v<T>, "unsupported option value type");
+		return value_kind::floating;
+	}
+}
+
+// Whether T is the type add_* declares options of its kind with: integers
+// are std::int64_t and floating point values double, so no read narrows.
+template <typename T>
+constexpr bool declared_type_v = kind_of<T>() == value_kind::integer    ? std::is_same_v<T, std::int64_t>
+                                 : kind_of<T>() == value_kind::floating ? std::is_same_v<T, double>
+                                                                        : true;
+
+} // namespace detail
+
+// Typed id of an option, as add_* return it. result::get reads through a
+// handle with one indexed load and no type check, as the type was fixed
+// when the option was added; reading it as any other type does not
+// compile. A handle converts to option_id for everything else.
+template <typename T>
+class option_handle {
+	static_assert(detail::declared_type_v<T>, "integer options are std::int64_t and floating ones double");
+
+public:
+	using value_type = T;
+
+	constexpr option_id id() const noexcept { return id_; }
+	constexpr operator option_id() const noexcept { return id_; }
+
+private:
+	friend class spec;
+	friend class merged_options;
+	constexpr explicit option_handle(option_id id) noexcept : id_(id) {}
+
+	option_id id_;
+};
+
+// Where spec::merge put the options of the spec it merged: option i of
+// that spec is base() + i here. Converts to base(), and rebase() turns a
+// handle add_* returned on the merged spec into a handle of the same
+// option here, which is the only kind result::get may be given.
+class merged_options {
+public:
+	constexpr option_id base() const noexcept { return base_; }
+	constexpr operator option_id() const noexcept { return base_; }
+	constexpr std::size_t size() const noexcept { return size_; }
+
+	// Throws std::out_of_range if handle names no option of the merged spec.
+	template <typename T>
+	option_handle<T> rebase(option_handle<T> handle) const {
+		if (handle.id() >= size_)
+			throw std::out_of_range("option " + std::to_string(handle.id()) + " was not merged");
+		return option_handle<T>(base_ + handle.id());
+	}
+
+private:
+	friend class spec;
+	constexpr merged_options(option_id base, std::size_t size) noexcept : base_(base), size_(size) {}
+
+	option_id base_;
+	std::size_t size_;
+};
+
+// The option a name or alias stands for.
+struct name_match {
+	option_id id = 0;
+	bool deprecated = false;
+};
+
+enum class alias_kind : std::uint8_t {
+	plain,
+	deprecated, // still accepted; each use is reported by result::diagnostics
+};
+
+class spec;
+
+// A node of the tree that dotted long names form: option `db.pool.size` is
+// `size` in group `pool` of group `db`. The tree is built as options are
+// added, one node per segment, so walking a group or binding it to a nested
+// struct never splits a name. Aliases are not part of it. Views its spec,
+// which must outlive it.
+class option_group {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = option_group;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const option_group *;
+		using reference = option_group;
+
+		iterator() noexcept = default;
+		iterator(const spec *options, std::uint32_t node) noexcept : options_(options), node_(node) {}
+
+		option_group operator*() const noexcept { return {options_, node_}; }
+		iterator &operator++() noexcept;
+		bool operator==(const iterator &other) const noexcept { return node_ == other.node_; }
+		bool operator!=(const iterator &other) const noexcept { return node_ != other.node_; }
+
+	private:
+		const spec *options_ = nullptr;
+		std::uint32_t node_ = 0;
+	};
+
+	option_group(const spec *options, std::uint32_t node) noexcept : options_(options), node_(node) {}
+
+	// Last segment of the path; empty for the root.
+	std::string_view name() const noexcept;
+	// The option whose long name is the whole path, if any.
+	std::optional<option_id> option() const noexcept;
+
+	// Child groups, ordered by segment.
+	iterator begin() const noexcept;
+	iterator end() const noexcept;
+
+	std::optional<option_group> child(std::string_view segment) const noexcept;
+	// Descends through each segment of a dotted path; the empty path is
+	// this group.
+	std::optional<option_group> find(std::string_view path) const noexcept;
+
+	// Calls fn(option_id) for this group's option and every option below
+	// it, depth first and ordered by segment.
+	template <typename Fn>
+	void for_each_option(Fn &&fn) const {
+		if (const std::optional<option_id> id = option())
+			fn(*id);
+		for (const option_group child : *this)
+			child.for_each_option(fn);
+	}
+
+private:
+	const spec *options_;
+	std::uint32_t node_;
+};
+
+struct option_def {
+	std::string long_name;
+	char short_name = '\0';
+	value_kind kind = value_kind::flag;
+	std::string default_text;
+	std::int64_t default_integer = 0;
+	double default_floating = 0.0;
+	std::vector<choice_entry> choices; // sorted by case folded name
+	choice_match match = choice_match::exact;
+	char separator = '\0'; // between pairs of a map value, or none
+	duplicate_key duplicates = duplicate_key::last_wins;
+	std::shared_ptr<const string_pattern> pattern; // what string values must match, or none
+	bool accepts_bytes = false; // values are exempt from spec::require_utf8
+
+	bool takes_value() const noexcept { return kind != value_kind::flag; }
+};
+
+// The set of options a command accepts. Options are numbered in the order
+// they are added; the returned ids index every per-option array.
+//
+// Short names are printable ASCII other than '-' and resolve through a
+// table indexed by the character, so splitting a cluster such as `-xvzf`
+// costs one load per letter; any other byte after a '-' is an unknown
+// option.
+//
+// Parsing only reads the spec and keeps no state in it, so once built a
+// spec can be shared by any number of threads parsing concurrently, with
+// no locking and no reference counting per parse. seal() turns accidental
+// later additions into errors; hand a sealed spec to workers by reference
+// or as std::shared_ptr<const spec>.
+class spec {
+public:
+	option_handle<bool> add_flag(std::string long_name, char short_name = '\0');
+	option_handle<std::string_view> add_string(std::string long_name, char short_name = '\0', std::string default_value = {});
+	option_handle<std::int64_t> add_int(std::string long_name, char short_name = '\0', std::int64_t default_value = 0);
+	option_handle<double> add_double(std::string long_name, char short_name = '\0', double default_value = 0.0);
+	// A string option whose values must match pattern; see string_pattern.
+	// The pattern is compiled here, once, and shared by options of this spec
+	// with the same pattern. Throws std::invalid_argument for a bad pattern
+	// or a default that does not match it.
+	option_handle<std::string_view> add_pattern(std::string long_name, char short_name, std::string_view pattern,
+	                                            std::string default_value = {});
+	option_handle<string_span> add_list(std::string long_name, char short_name = '\0');
+	// A map option takes `key=value`; with a separator one occurrence may
+	// carry several pairs, as in `--labels a=1,b=2`.
+	option_handle<flat_string_map> add_map(std::string long_name, char short_name = '\0', char separator = '\0',
+	                                        duplicate_key duplicates = duplicate_key::last_wins);
+
+	template <typename Enum, std::size_t N>
+	option_handle<Enum> add_choice(std::string long_name, char short_name, const choice_table<Enum, N> &choices,
+	                               Enum default_value, choice_match match = choice_match::exact) {
+		option_def def;
+		def.long_name = std::move(long_name);
+		def.short_name = short_name;
+		def.kind = value_kind::choice;
+		def.default_integer = static_cast<std::int64_t>(default_value);
+		def.choices.assign(choices.entries().begin(), choices.entries().end());
+		def.match = match;
+		return option_handle<Enum>(add(std::move(def)));
+	}
+
+	// Makes long_name and short_name (either may be empty) further names of
+	// option id. Aliases go into the same lookup index as the names they
+	// stand for, so resolving one costs what resolving the option's own name
+	// does. Throws like add_* for duplicate names and std::out_of_range for
+	// an unknown id.
+	void add_alias(option_id id, std::string long_name, char short_name = '\0',
+	               alias_kind kind = alias_kind::plain);
+
+	// Appends the options of other, such as those a plugin contributes, and
+	// returns where they went: option i of other becomes base + i, and its
+	// aliases come along; handles from other's add_* must be rebased before
+	// they read results of this spec. Existing entries are not
+	// rebuilt: other's long names join the index as one more sorted
+	// segment, and only neighbouring segments of similar size are merged,
+	// so n options cost O(n log n) however they arrive and a lookup
+	// searches O(log n) segments. Throws like add_* on a clash, leaving this
+	// spec unchanged. Whether other requires UTF-8 or accepts positional
+	// bytes is ignored.
+	merged_options merge(spec other);
+
+	// Makes parsing reject arguments that are not valid UTF-8 with
+	// error_code::invalid_encoding, each checked when first read. Off by
+	// default, where arguments are bytes and pass through untouched. Long
+	// names must be valid UTF-8 either way. Throws std::logic_error once
+	// sealed.
+	void require_utf8(bool required = true);
+	bool requires_utf8() const noexcept { return utf8_; }
+
+	// Exempts the values of option id, or positionals, from require_utf8,
+	// for arguments such as file names that are bytes whatever the locale.
+	// Their bytes are kept exactly as given either way; the rest of an
+	// argument, such as the name in `--path=...`, is still checked. Only
+	// string, list and map options qualify: anything else throws
+	// std::invalid_argument. Throws std::logic_error once sealed.
+	void accept_bytes(option_id id);
+	void accept_positional_bytes(bool accepted = true);
+	bool accepts_bytes(option_id id) const { return defs_.at(id).accepts_bytes; }
+	bool positionals_accept_bytes() const noexcept { return positional_bytes_; }
+
+	// Makes every later add_* throw std::logic_error.
+	void seal() noexcept { sealed_ = true; }
+	bool sealed() const noexcept { return sealed_; }
+
+	std::size_t size() const noexcept { return defs_.size(); }
+	const option_def &def(option_id id) const { return defs_.at(id); }
+
+	std::optional<name_match> resolve_long(std::string_view name) const noexcept;
+	std::optional<name_match> resolve_short(char name) const noexcept;
+
+	std::optional<option_id> find_long(std::string_view name) const noexcept;
+	std::optional<option_id> find_short(char name) const noexcept;
+
+	bool takes_value(option_id id) const { return defs_.at(id).takes_value(); }
+	// `--long_name`, or `-x` for an option with only a short name.
+	std::string display_name(option_id id) const;
+
+	// Id of the option with the given long name; throws std::out_of_range.
+	option_id id(std::string_view long_name) const;
+
+	// Handle reading option id, or the option with the given long name, as
+	// T, for options whose handle from add_* is gone. T must be the type
+	// add_* would have given the handle. Resolves and checks the type once:
+	// throws std::logic_error if the option is of another kind, and
+	// std::out_of_range for an unknown option.
+	template <typename T>
+	option_handle<T> handle(option_id id) const;
+	template <typename T>
+	option_handle<T> handle(std::string_view long_name) const {
+		return handle<T>(id(long_name));
+	}
+
+	// Root of the tree of dotted long names, and the group at a dotted path.
+	option_group groups() const noexcept { return {this, 0}; }
+	std::optional<option_group> group(std::string_view path) const noexcept { return groups().find(path); }
+
+private:
+	friend class option_group;
+
+	struct long_entry {
+		std::string name;
+		name_match match;
+	};
+
+	static constexpr std::uint32_t no_node = static_cast<std::uint32_t>(-1);
+	static constexpr option_id no_option = static_cast<option_id>(-1);
+
+	// A trie node. Children of a node form a sibling list sorted by segment.
+	struct group_node {
+		std::string segment;
+		option_id option = no_option;
+		std::uint32_t first_child = no_node;
+		std::uint32_t next_sibling = no_node;
+	};
+
+	static constexpr std::uint32_t deprecated_short = std::uint32_t{1} << 31;
+
+	option_id add(option_def def);
+	void check_names(const std::string &long_name, char short_name) const;
+	void index_names(std::string long_name, char short_name, name_match match);
+	void add_to_groups(std::string_view long_name, option_id id);
+	void compact_long_index();
+
+	std::vector<option_def> defs_;
+	// Long names and aliases in segments, each sorted by name, with sizes
+	// decreasing; add_* inserts into the last one.
+	std::vector<std::vector<long_entry>> long_index_;
+	// Short names and aliases indexed by ASCII code: 0 for none, else the
+	// option id + 1 with deprecated_short set for deprecated aliases.
+	std::array<std::uint32_t, 128> short_table_{};
+	std::vector<group_node> groups_{1}; // root first
+	bool sealed_ = false;
+	bool utf8_ = false;
+	bool positional_bytes_ = false;
+};
+
+template <typename T>
+option_handle<T> spec::handle(option_id id) const {
+	if (def(id).kind != detail::kind_of<T>())
+		throw std::logic_error("option " + display_name(id) + " does not read as the requested type");
+	return option_handle<T>(id);
+}
+
+// Non-owning view of the arguments to parse, without the program name.
+class arg_list {
+public:
+	arg_list(int argc, const char *const *argv) noexcept
+	    : argv_(argc > 0 ? argv + 1 : argv), size_(argc > 0 ? static_cast<std::size_t>(argc - 1) : 0) {}
+	arg_list(const std::string_view *args, std::size_t size) noexcept : views_(args), size_(size) {}
+	arg_list(const std::vector<std::string_view> &args) noexcept : views_(args.data()), size_(args.size()) {}
+
+	std::size_t size() const noexcept { return size_; }
+	std::string_view operator[](std::size_t i) const noexcept {
+		return views_ != nullptr ? views_[i] : std::string_view(argv_[i]);
+	}
+
+private:
+	const char *const *argv_ = nullptr;
+	const std::string_view *views_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+struct token {
+	enum class type : std::uint8_t { option, positional };
+
+	type kind = type::positional;
+	option_id id = 0;
+	std::string_view value; // option value, or the positional itself
+	std::size_t index = 0;  // argument the token came from
+	std::string_view name;  // option name as written: `--long`, or the short letter
+	bool deprecated = false; // named by a deprecated alias
+};
+
+namespace detail {
+
+// How conversion errors name an option: `--long_name`, or `-short_name`
+// when it has no long name.
+struct option_label {
+	std::string_view long_name;
+	char short_name = '\0';
+};
+
+// Conversions shared by result, the pull parser and generated parsers. Each
+// throws parse_error with error_code::invalid_value.
+std::int64_t to_integer(const token &tok, option_label label);
+double to_floating(const token &tok, option_label label);
+const choice_entry &to_choice(const token &tok, option_label label, const choice_entry *entries, std::size_t size,
+                              choice_match match);
+void check_pattern(const token &tok, option_label label, const string_pattern &pattern);
+void insert_pairs(const token &tok, option_label label, char separator, duplicate_key duplicates,
+                  flat_string_map &map);
+// Message for a use of a deprecated alias of the labelled option.
+std::string deprecation(const token &tok, option_label label);
+// Throws parse_error with error_code::invalid_encoding unless arg, argument
+// index of the list, is valid UTF-8.
+void check_utf8(std::string_view arg, std::size_t index);
+
+// Keeps the parse_error of the earliest argument among several conversions.
+class first_error {
+public:
+	template <typename Fn>
+	void capture(Fn &&fn) {
+		try {
+			fn();
+		} catch (const parse_error &e) {
+			if (!error_ || e.index() < error_->index())
+				error_ = e;
+		}
+	}
+
+	void rethrow() const {
+		if (error_)
+			throw *error_;
+	}
+
+private:
+	std::optional<parse_error> error_;
+};
+
+} // namespace detail
+
+// Splits arguments into option and positional tokens. Understands
+// `--name=value`, `--name value`, `-x`, `-xvalue`, `-x value`, clusters of
+// short flags such as `-abc`, and `--` to end option processing. With utf8
+// set, every argument is validated as it is read, except the values of
+// options and the positionals Names exempts.
+//
+// Names resolves option names; spec is the usual one, and generated parsers
+// bring their own with the names compiled into switches. It needs
+//   std::optional<name_match> resolve_long(std::string_view name) const;
+//   std::optional<name_match> resolve_short(char name) const;
+//   bool takes_value(option_id id) const;
+//   bool accepts_bytes(option_id id) const;
+//   bool positionals_accept_bytes() const;
+//   std::string display_name(option_id id) const;
+template <typename Names>
+class basic_tokenizer {
+public:
+	basic_tokenizer(const Names &names, arg_list args, bool utf8 = false) noexcept
+	    : names_(&names), args_(args), utf8_(utf8) {}
+
+	// Produces the next token; returns false once the arguments are used up.
+	bool next(token &out);
+
+	// Number of arguments read so far.
+	std::size_t position() const noexcept { return index_; }
+
+private:
+	bool next_short(token &out);
+	std::string_view take_value(std::size_t option_index, option_id id);
+	std::size_t checked_length(std::string_view cluster) const;
+
+	const Names *names_;
+	arg_list args_;
+	std::size_t index_ = 0;
+	std::string_view cluster_; // rest of a short option cluster being split
+	bool options_done_ = false;
+	bool utf8_;
+};
+
+template <typename Names>
+bool basic_tokenizer<Names>::next(token &out) {
+	if (!cluster_.empty())
+		return next_short(out);
+	if (index_ >= args_.size())
+		return false;
+
+	const std::size_t index = index_++;
+	const std::string_view arg = args_[index];
+	if (options_done_ || arg.size() < 2 || arg[0] != '-') {
+		if (utf8_ && !names_->positionals_accept_bytes())
+			detail::check_utf8(arg, index);
+		out = {token::type::positional, 0, arg, index, {}, false};
+		return true;
+	}
+	if (arg == "--") {
+		options_done_ = true;
+		return next(out);
+	}
+	if (arg[1] != '-') {
+		if (utf8_)
+			detail::check_utf8(arg.substr(0, 1 + checked_length(arg.substr(1))), index);
+		cluster_ = arg.substr(1);
+		return next_short(out);
+	}
+
+	const std::string_view body = arg.substr(2);
+	const std::size_t eq = body.find('=');
+	const std::string_view name = body.substr(0, eq);
+	const std::optional<name_match> found = names_->resolve_long(name);
+	if (utf8_) {
+		const bool bytes = found && eq != std::string_view::npos && names_->accepts_bytes(found->id);
+		detail::check_utf8(bytes ? arg.substr(0, name.size() + 2) : arg, index);
+	}
+	if (!found)
+		throw parse_error(error_code::unknown_option, index, "unknown option --" + std::string(name));
+
+	out = {token::type::option, found->id, {}, index, arg.substr(0, name.size() + 2), found->deprecated};
+	if (names_->takes_value(found->id)) {
+		out.value = eq != std::string_view::npos ? body.substr(eq + 1) : take_value(index, found->id);
+	} else if (eq != std::string_view::npos) {
+		throw parse_error(error_code::unexpected_value, index, "option --" + std::string(name) + " takes no value");
+	}
+	return true;
+}
+
+template <typename Names>
+bool basic_tokenizer<Names>::next_short(token &out) {
+	const std::size_t index = index_ - 1;
+	const std::string_view name = cluster_.substr(0, 1);
+	cluster_.remove_prefix(1);
+	const std::optional<name_match> found = names_->resolve_short(name[0]);
+	if (!found)
+		throw parse_error(error_code::unknown_option, index, "unknown option -" + std::string(name));
+
+	out = {token::type::option, found->id, {}, index, name, found->deprecated};
+	if (names_->takes_value(found->id)) {
+		out.value = !cluster_.empty() ? cluster_ : take_value(index, found->id);
+		cluster_ = {};
+	}
+	return true;
+}
+
+template <typename Names>
+std::string_view basic_tokenizer<Names>::take_value(std::size_t option_index, option_id id) {
+	if (index_ >= args_.size())
+		throw parse_error(error_code::missing_value, option_index,
+		                  "option " + names_->display_name(id) + " requires a value");
+	if (utf8_ && !names_->accepts_bytes(id))
+		detail::check_utf8(args_[index_], index_);
+	return args_[index_++];
+}
+
+// Bytes of a short option cluster that must be valid UTF-8: all of it,
+// unless the letters lead to an option that accepts bytes in its value.
+template <typename Names>
+std::size_t basic_tokenizer<Names>::checked_length(std::string_view cluster) const {
+	for (std::size_t i = 0; i < cluster.size(); ++i) {
+		const std::optional<name_match> found = names_->resolve_short(cluster[i]);
+		if (!found)
+			break;
+		if (names_->takes_value(found->id))
+			return names_->accepts_bytes(found->id) ? i + 1 : cluster.size();
+	}
+	return cluster.size();
+}
+
+using tokenizer = basic_tokenizer<spec>;
+extern template class basic_tokenizer<spec>;
+
+struct value_slot {
+	std::uint32_t count = 0;
+	std::uint32_t reserved = 0; // list capacity laid out by reserve_values
+	std::string_view text;
+	std::int64_t integer = 0; // for lists, offset of the first value; for maps, index of the map
+	double floating = 0.0;
+	std::size_t index = 0; // argument text came from
+	bool pending = false;  // text not yet converted into integer or floating
+};
+
+struct diagnostic {
+	std::size_t index = 0; // argument it is about
+	option_id id = 0;
+	std::string message;
+};
+
+// Contiguous run of list values.
+class string_span {
+public:
+	string_span() noexcept = default;
+	string_span(const std::string_view *data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+	const std::string_view *begin() const noexcept { return data_; }
+	const std::string_view *end() const noexcept { return data_ + size_; }
+	const std::string_view *data() const noexcept { return data_; }
+	std::size_t size() const noexcept { return size_; }
+	bool empty() const noexcept { return size_ == 0; }
+	std::string_view operator[](std::size_t i) const noexcept { return data_[i]; }
+
+private:
+	const std::string_view *data_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+namespace detail {
+
+// Maps are returned by reference, everything else by value.
+template <typename T>
+using get_t = std::conditional_t<std::is_same_v<T, flat_string_map>, const flat_string_map &, T>;
+
+} // namespace detail
+
+// Values of one parse, stored flat and indexed by option id. String values
+// are views into the parsed arguments, which must outlive the result.
+class result {
+public:
+	explicit result(const spec &options);
+
+	// Sizes value storage up front; counts[id] is the number of list values
+	// or map pairs option id will receive. All list values are laid out in
+	// one buffer, so this must precede apply() of any list token, and may be
+	// called once.
+	void reserve_values(const std::vector<std::uint32_t> &counts);
+
+	// Records one token; throws parse_error for malformed map pairs. Numbers,
+	// choices and patterned strings are only stored as text and converted or
+	// matched on first read.
+	void apply(const token &tok);
+
+	// Converts every value not read yet, throwing the parse_error of the
+	// earliest argument that does not convert. Values overridden by a later
+	// occurrence before they were converted are checked too, so validate()
+	// rejects what visit() and pull_parser would, though get() reads the
+	// value an option ends up with all the same. Reads convert and memoize
+	// in place, so a result shared between threads must be validated before
+	// they read it.
+	void validate() const;
+
+	bool has(option_id id) const { return slots_.at(id).count != 0; }
+	std::uint32_t count(option_id id) const { return slots_.at(id).count; }
+
+	// Reads the value of option id, converting it on first access; throws
+	// parse_error if it does not convert. T is the type add_* declares the
+	// option with, so integers read as std::int64_t and floating point
+	// values as double, never narrowed; another kind throws
+	// std::logic_error.
+	template <typename T>
+	detail::get_t<T> get(option_id id) const;
+	template <typename T>
+	detail::get_t<T> get(std::string_view long_name) const {
+		return get<T>(spec_->id(long_name));
+	}
+
+	// Reads the value of the option handle refers to, as the type of the
+	// handle, with no type check and no bounds check outside debug builds:
+	// handle must come from this result's spec, or be rebased onto it by
+	// merged_options. Values not yet converted are converted as by
+	// get(option_id) first.
+	template <typename T = void, typename U, std::enable_if_t<std::is_void_v<T> || std::is_same_v<T, U>, int> = 0>
+	detail::get_t<U> get(option_handle<U> handle) const;
+	template <typename T, typename U, std::enable_if_t<!std::is_void_v<T> && !std::is_same_v<T, U>, int> = 0>
+	detail::get_t<T> get(option_handle<U> handle) const = delete;
+
+	const std::vector<std::string_view> &positionals() const noexcept { return positionals_; }
+
+	// Notes on arguments that parsed fine, such as uses of deprecated
+	// aliases, in argument order. Collected rather than printed, so the
+	// caller decides whether and where to report them.
+	const std::vector<diagnostic> &diagnostics() const noexcept { return diagnostics_; }
+
+private:
+	friend std::string save_snapshot(const result &parsed);
+	friend result restore_snapshot(const spec &options, std::string_view bytes);
+	friend change_set diff(const result &before, const result &after);
+
+	const value_slot &checked_slot(option_id id, value_kind kind) const;
+	void convert(option_id id) const;
+	template <typename T>
+	detail::get_t<T> value_of(const value_slot &slot) const;
+
+	const spec *spec_;
+	mutable std::vector<value_slot> slots_;
+	std::vector<std::string_view> positionals_;
+	std::vector<std::string_view> list_values_;
+	std::vector<flat_string_map> maps_;
+	std::vector<diagnostic> diagnostics_;
+	std::vector<token> overridden_; // unconverted occurrences a later one replaced, for validate()
+};
+
+template <typename T>
+detail::get_t<T> result::get(option_id id) const {
+	static_assert(detail::declared_type_v<T>, "integer options read as std::int64_t and floating ones as double");
+	return value_of<T>(checked_slot(id, detail::kind_of<T>()));
+}
+
+template <typename T, typename U, std::enable_if_t<std::is_void_v<T> || std::is_same_v<T, U>, int>>
+detail::get_t<U> result::get(option_handle<U> handle) const {
+	assert(handle.id() < slots_.size() && spec_->def(handle.id()).kind == detail::kind_of<U>());
+	const value_slot &slot = slots_[handle.id()];
+	// Flags, lists and maps are never left to convert.
+	if constexpr (detail::kind_of<U>() != value_kind::flag && detail::kind_of<U>() != value_kind::list &&
+	              detail::kind_of<U>() != value_kind::map) {
+		if (slot.pending)
+			convert(handle.id());
+	}
+	return value_of<U>(slot);
+}
+
+template <typename T>
+detail::get_t<T> result::value_of(const value_slot &slot) const {
+	if constexpr (std::is_same_v<T, bool>)
+		return slot.count != 0;
+	else if constexpr (std::is_same_v<T, std::string_view>)
+		return slot.text;
+	else if constexpr (std::is_same_v<T, string_span>)
+		return string_span(list_values_.data() + slot.integer, slot.count);
+	else if constexpr (std::is_same_v<T, flat_string_map>)
+		return maps_[static_cast<std::size_t>(slot.integer)];
+	else if constexpr (std::is_floating_point_v<T>)
+		return static_cast<T>(slot.floating);
+	else
+		return static_cast<T>(slot.integer);
+}
+
+// Parses args against options; throws parse_error, or limit_error once
+// args exceed limits. Numbers and choices are converted when read, so their
+// errors surface from result::get, or up front from result::validate.
+// Only max_args, max_bytes and max_values apply here; the argument count
+// and size are checked before anything is allocated, and value counts
+// before list and map storage is reserved.
+//
+// Complexity: parsing, visiting, split_command and response file expansion
+// all run in time linear in the total bytes of the arguments (including
+// bytes read from response files), whatever their shape: each byte is
+// examined a bounded number of times, lookups cost the length of the name
+// times a factor that depends only on the spec, and map keys are hashed
+// with a keyed hash that crafted keys cannot collide. Scaling tests in
+// option_parser_tests hold this in place. The one exception is reading a
+// string option whose pattern falls back to std::regex, which backtracks.
+result parse(const spec &options, arg_list args, const parse_limits &limits = {});
+result parse(const spec &options, int argc, const char *const *argv, const parse_limits &limits = {});
+
+// Parse in pieces tokenized apart, for argument lists of which only some
+// pieces change between parses, such as a set of config files: tokenize()
+// splits one piece, applying max_args and max_bytes to it, and
+// parse_tokens() applies the tokens of all the pieces in order, as parse()
+// would, applying max_values. An option and its value must be in the same
+// piece, and `--` ends option processing only to the end of its piece.
+// Token indices number the arguments of their own piece; the caller offsets
+// them to number the whole list. Tokens view the arguments, which must
+// outlive the result.
+std::vector<token> tokenize(const spec &options, arg_list args, const parse_limits &limits = {});
+result parse_tokens(const spec &options, const std::vector<token> &tokens, const parse_limits &limits = {});
+
+// One converted occurrence of an option, as handed to a visitor. Map
+// options produce one value per key=value pair.
+struct option_value {
+	option_id id = 0;
+	value_kind kind = value_kind::flag;
+	std::size_t index = 0;  // argument the value came from
+	std::string_view key;   // map pairs only
+	std::string_view text;  // raw text; for choices the matched name
+	std::int64_t integer = 0;
+	double floating = 0.0;
+	bool deprecated = false; // named by a deprecated alias
+
+	// Typed view of the value with the same types as result::get, except
+	// that lists and maps read as std::string_view; throws std::logic_error
+	// on a mismatch. Numbers read only as std::int64_t and double, so no
+	// read narrows.
+	template <typename T>
+	T as() const;
+};
+
+struct parse_event {
+	token::type kind = token::type::option;
+	option_value value; // positionals only set index and text
+};
+
+// Lazily converts options one at a time; arguments after the last event
+// pulled are never looked at, so a caller can stop at `--help` or at a
+// subcommand name without paying for the rest. Iterating with begin() and
+// end() walks the same events; a parse_error surfaces from next() or from
+// advancing the iterator.
+class pull_parser {
+public:
+	class iterator {
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = parse_event;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const parse_event *;
+		using reference = const parse_event &;
+
+		iterator() noexcept = default;
+		explicit iterator(pull_parser &parser) : parser_(&parser) { ++*this; }
+
+		reference operator*() const noexcept { return event_; }
+		pointer operator->() const noexcept { return &event_; }
+		iterator &operator++() {
+			if (!parser_->next(event_))
+				parser_ = nullptr;
+			return *this;
+		}
+		bool operator==(const iterator &other) const noexcept { return parser_ == other.parser_; }
+		bool operator!=(const iterator &other) const noexcept { return parser_ != other.parser_; }
+
+	private:
+		pull_parser *parser_ = nullptr;
+		parse_event event_;
+	};
+
+	pull_parser(const spec &options, arg_list args) noexcept
+	    : spec_(&options), tokens_(options, args, options.requires_utf8()) {}
+
+	// Produces the next event; returns false once the arguments are used up.
+	bool next(parse_event &out);
+
+	iterator begin() { return iterator(*this); }
+	iterator end() noexcept { return iterator(); }
+
+	// Number of arguments read so far.
+	std::size_t consumed() const noexcept { return tokens_.position(); }
+
+private:
+	const spec *spec_;
+	tokenizer tokens_;
+	token current_;
+	std::string_view pairs_; // unread pairs of the current map occurrence
+	bool pairs_left_ = false;
+};
+
+class visitor {
+public:
+	virtual ~visitor() = default;
+	virtual void on_option(const option_value &value) = 0;
+	virtual void on_positional(std::string_view value, std::size_t index) = 0;
+};
+
+// Parses without building a result: every option and positional is
+// converted and handed to callbacks in argument order as soon as it is
+// recognized. On a parse_error the callbacks for earlier arguments have
+// already run.
+void visit(const spec &options, arg_list args, visitor &callbacks);
+
+template <typename OnOption, typename OnPositional>
+void visit(const spec &options, arg_list args, OnOption &&on_option, OnPositional &&on_positional) {
+	struct adapter final : visitor {
+		OnOption &option;
+		OnPositional &positional;
+		adapter(OnOption &o, OnPositional &p) : option(o), positional(p) {}
+		void on_option(const option_value &value) override { option(value); }
+		void on_positional(std::string_view value, std::size_t index) override { positional(value, index); }
+	} callbacks(on_option, on_positional);
+	visit(options, args, callbacks);
+}
+
+template <typename T>
+T option_value::as() const {
+	static_assert(detail::declared_type_v<T>, "integer values read as std::int64_t and floating ones as double");
+	if constexpr (std::is_same_v<T, std::string_view>) {
+		if (kind == value_kind::string || kind == value_kind::list || kind == value_kind::map)
+			return text;
+	} else if (kind == detail::kind_of<T>()) {
+		if constexpr (std::is_same_v<T, bool>)
+			return true;
+		else if constexpr (std::is_floating_point_v<T>)
+			return static_cast<T>(floating);
+		else
+			return static_cast<T>(integer);
+	}
+	throw std::logic_error("option value read with the wrong type");
+}
+
+} // namespace option_parser
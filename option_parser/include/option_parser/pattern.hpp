@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+
+namespace option_parser {
+
+// Constraint on the text of a string option, compiled once when the option
+// is added to a spec and shared by every parse. The pattern is an ECMAScript
+// regular expression that must match the whole value.
+//
+// Patterns made of one character class and an optional quantifier, such as
+// `[a-z0-9-]{1,63}`, `\d+` or `[^/]*`, are compiled to a byte set and a
+// length range and matched without std::regex; anything else falls back
+// to a std::regex built here once, whose matching backtracks and so is best
+// kept to trusted or length limited input. Matching is const and may run
+// from any number of threads.
+class string_pattern {
+public:
+	// Throws std::invalid_argument if pattern is not a valid expression.
+	explicit string_pattern(std::string_view pattern);
+
+	bool matches(std::string_view text) const;
+
+	const std::string &source() const noexcept { return source_; }
+
+	// Whether matching takes the byte set fast path.
+	bool is_simple() const noexcept { return !regex_; }
+
+private:
+	bool compile_simple();
+
+	std::string source_;
+	std::array<std::uint64_t, 4> bytes_{}; // allowed bytes of a simple pattern
+	std::size_t min_length_ = 0;
+	std::size_t max_length_ = 0;
+	std::optional<std::regex> regex_;
+};
+
+} // namespace option_parser
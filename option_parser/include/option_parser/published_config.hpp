@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "option_parser/config.hpp"
+
+namespace option_parser {
+
+// Holds the current config for any number of reader threads, which read it
+// wait-free: a read announces the epoch it started in, loads the pointer
+// and clears the announcement when done, with no locks, retries or
+// reference counts. Writers install new configs and keep the ones they
+// replace until every reader that may still see them has finished; a
+// config retired in epoch e is released once no reader announces an epoch
+// at or before e.
+//
+// Readers register once per thread through a reader, which owns one of a
+// fixed number of slots, each on its own cache line.
+class published_config {
+public:
+	static constexpr std::size_t default_max_readers = 256;
+
+	// Throws std::invalid_argument if initial is null.
+	explicit published_config(std::shared_ptr<const config> initial, std::size_t max_readers = default_max_readers);
+	// Every reader must be destroyed first.
+	~published_config();
+
+	published_config(const published_config &) = delete;
+	published_config &operator=(const published_config &) = delete;
+
+	class reader;
+
+	// Keeps the config it was read from alive until destroyed. Not nestable
+	// within one reader: destroy a guard before reading again.
+	class guard {
+	public:
+		guard(guard &&other) noexcept : slot_(std::exchange(other.slot_, nullptr)), current_(other.current_) {}
+		guard &operator=(guard &&) = delete;
+		~guard() {
+			if (slot_)
+				slot_->store(quiescent, std::memory_order_release);
+		}
+
+		const config &operator*() const noexcept { return *current_; }
+		const config *operator->() const noexcept { return current_; }
+		const config *get() const noexcept { return current_; }
+
+	private:
+		friend class reader;
+		guard(std::atomic<std::uint64_t> *slot, const config *current) noexcept : slot_(slot), current_(current) {}
+
+		std::atomic<std::uint64_t> *slot_;
+		const config *current_;
+	};
+
+	// One reading thread's slot. Claiming and releasing a slot is lock-free;
+	// read() is wait-free. Throws std::length_error when every slot is taken.
+	class reader {
+	public:
+		explicit reader(published_config &published);
+		~reader();
+
+		reader(const reader &) = delete;
+		reader &operator=(const reader &) = delete;
+
+		guard read() const noexcept {
+			published_->slots_[slot_].epoch.store(published_->epoch_.load(std::memory_order_acquire),
+			                                      std::memory_order_seq_cst);
+			return guard(&published_->slots_[slot_].epoch, published_->current_.load(std::memory_order_seq_cst));
+		}
+
+	private:
+		published_config *published_;
+		std::size_t slot_;
+	};
+
+	// Publishes next, which readers see from their next read(), and releases
+	// what retired configs it can. Throws std::invalid_argument if next is
+	// null. Writers may call this from several threads; they are serialized.
+	void install(std::shared_ptr<const config> next);
+
+	// The config readers currently get; for writers, which hold it alive.
+	std::shared_ptr<const config> current() const;
+
+	// Releases retired configs no reader can still see and returns how many
+	// are left waiting for readers.
+	std::size_t reclaim();
+
+private:
+	static constexpr std::uint64_t quiescent = 0;
+
+	struct alignas(64) slot {
+		std::atomic<std::uint64_t> epoch{quiescent};
+		std::atomic<bool> claimed{false};
+	};
+
+	struct retired {
+		std::uint64_t epoch;
+		std::shared_ptr<const config> value;
+	};
+
+	std::size_t reclaim_locked();
+
+	std::unique_ptr<slot[]> slots_;
+	std::size_t slot_count_;
+	std::atomic<std::uint64_t> epoch_{1};
+	std::atomic<const config *> current_;
+	mutable std::mutex writers_; // guards owner_ and retired_
+	std::shared_ptr<const config> owner_;
+	std::vector<retired> retired_;
+};
+
+} // namespace option_parser
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser {
+
+// Reads delimited records (for instance the output of `find -print0`) from a
+// file descriptor through a fixed buffer, so arbitrarily long argument lists
+// can be consumed in bounded memory. The buffer only grows to fit a single
+// record longer than it, and never beyond max_record bytes.
+class record_reader {
+public:
+	static constexpr std::size_t default_buffer = 64 * 1024;
+	static constexpr std::size_t default_max_record = 1024 * 1024;
+
+	explicit record_reader(int fd, char delimiter = '\n', std::size_t buffer_size = default_buffer,
+	                       std::size_t max_record = default_max_record);
+
+	// Produces the next record without its delimiter. The view is valid until
+	// the next call. A final record need not be terminated. Returns false at
+	// end of stream; throws std::system_error when reading fails and
+	// std::length_error for a record longer than max_record.
+	bool next(std::string_view &record);
+
+private:
+	bool fill();
+
+	int fd_;
+	char delimiter_;
+	std::size_t max_record_;
+	std::vector<char> buffer_;
+	std::size_t begin_ = 0;   // start of the unconsumed bytes
+	std::size_t scanned_ = 0; // bytes from begin_ known to hold no delimiter
+	std::size_t end_ = 0;
+	bool eof_ = false;
+};
+
+// Calls fn with every positional in order, replacing each positional equal
+// to marker (`-` by default) with the records read from fd. Returns the
+// number of values passed to fn.
+template <typename Fn>
+std::size_t for_each_positional(const result &parsed, int fd, char delimiter, Fn &&fn,
+                                std::string_view marker = "-") {
+	std::size_t count = 0;
+	for (const std::string_view positional : parsed.positionals()) {
+		if (positional != marker) {
+			fn(positional);
+			++count;
+			continue;
+		}
+		record_reader records(fd, delimiter);
+		std::string_view record;
+		while (records.next(record)) {
+			fn(record);
+			++count;
+		}
+	}
+	return count;
+}
+
+} // namespace option_parser
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "option_parser/command_line.hpp"
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser {
+
+// Returns the contents of path, or nothing if it cannot be read. A loader
+// need not read more than max_size + 1 bytes: anything longer than max_size
+// is rejected without looking at the rest.
+using file_loader = std::function<std::optional<std::string>(std::string_view path, std::size_t max_size)>;
+
+std::optional<std::string> read_file(std::string_view path, std::size_t max_size = parse_limits::unlimited);
+
+// Arguments with response files expanded. Owns the file contents the
+// expanded words refer to; arguments that were not expanded still view the
+// original list, which must outlive this object.
+class expanded_args {
+public:
+	const std::vector<std::string_view> &args() const noexcept { return args_; }
+	std::size_t size() const noexcept { return args_.size(); }
+	std::string_view operator[](std::size_t i) const noexcept { return args_[i]; }
+
+	operator arg_list() const noexcept { return arg_list(args_); }
+
+private:
+	friend expanded_args expand_response_files(arg_list args, const file_loader &load, const parse_limits &limits);
+
+	std::vector<std::string_view> args_;
+	std::vector<std::unique_ptr<std::string>> contents_;
+	std::vector<command_line> words_;
+};
+
+// Replaces every argument of the form `@path` with the words of that file,
+// split with shell quoting rules as by split_command; words of a file may
+// name further response files. A lone `@` is kept as is. Throws parse_error
+// with error_code::response_file, indexed by the top-level argument, when a
+// file cannot be read, and error_code::bad_quoting for malformed file
+// contents. Throws limit_error when nesting or the bytes read exceed the
+// response file limits, or the expanded arguments exceed max_args or
+// max_bytes; files are read no further than the remaining byte budget.
+expanded_args expand_response_files(arg_list args, const file_loader &load = read_file,
+                                    const parse_limits &limits = {});
+
+} // namespace option_parser
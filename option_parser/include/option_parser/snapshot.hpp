@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser {
+
+// Snapshots store a parse result as option ids and typed values, with no
+// option names, so a process can hand its parsed configuration to workers
+// that restore it without parsing again.
+//
+// Layout, in native byte order (a marker in the header rejects snapshots
+// from a host of the other order):
+//
+//   header      magic "OPSN", u16 version, u16 byte order marker, u32 counts
+//               of options, positionals, list values, map entries, and the
+//               string pool size
+//   options     one 40 byte record per option id: kind, occurrence count,
+//               extent (list values or map entries), text reference,
+//               integer and floating values
+//   strings     u32 offset and size into the pool for each positional,
+//               each list value and each map key and value
+//   pool        the bytes of every string, unterminated
+//
+// Readers accept every version up to their own and reject newer ones.
+constexpr std::uint16_t snapshot_version = 1;
+
+// Serializes parsed, validating it first; throws its parse_error, or
+// std::length_error if its strings exceed 4 GiB.
+std::string save_snapshot(const result &parsed);
+
+// Rebuilds a result for options from a snapshot. Strings in the result view
+// bytes, which must outlive it; only map indexes are rebuilt. The snapshot
+// may come from an older build of the spec, as long as its options are a
+// prefix of options with the same kinds; options it does not know hold their
+// defaults. Throws std::invalid_argument for malformed or incompatible input.
+result restore_snapshot(const spec &options, std::string_view bytes);
+
+// Read-only memory map of a whole file, so a snapshot can be restored
+// straight from the page cache.
+class mapped_file {
+public:
+	// Throws std::system_error if path cannot be opened or mapped.
+	explicit mapped_file(const std::string &path);
+	~mapped_file();
+
+	mapped_file(mapped_file &&other) noexcept;
+	mapped_file &operator=(mapped_file &&other) noexcept;
+	mapped_file(const mapped_file &) = delete;
+	mapped_file &operator=(const mapped_file &) = delete;
+
+	std::string_view bytes() const noexcept { return {static_cast<const char *>(data_), size_}; }
+
+private:
+	void *data_ = nullptr;
+	std::size_t size_ = 0;
+};
+
+} // namespace option_parser
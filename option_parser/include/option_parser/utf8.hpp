@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace option_parser {
+
+// Offset of the first byte of text that does not begin a well formed UTF-8
+// sequence, or std::string_view::npos if there is none. Well formed means
+// as in Unicode table 3-7: no overlong forms, no surrogates, nothing past
+// U+10FFFF, no truncated sequences. The offset of a bad or truncated
+// multibyte sequence is that of its lead byte.
+//
+// Runs of ASCII are skipped eight bytes per step, so plain paths and
+// labels cost a load and a mask per word; only bytes of multibyte
+// sequences are decoded one at a time.
+std::size_t find_invalid_utf8(std::string_view text) noexcept;
+
+inline bool is_valid_utf8(std::string_view text) noexcept {
+	return find_invalid_utf8(text) == std::string_view::npos;
+}
+
+} // namespace option_parser
@@ -0,0 +1,148 @@
+#include "option_parser/command_line.hpp"
+
+#include <cstring>
+
+namespace option_parser {
+
+namespace {
+
+bool is_blank(char c) noexcept {
+	return c == ' ' || c == '\t' || c == '\n';
+}
+
+bool ends_plain_run(char c) noexcept {
+	return is_blank(c) || c == '\'' || c == '"' || c == '\\';
+}
+
+// Characters a backslash escapes inside double quotes.
+bool escapable_in_double_quotes(char c) noexcept {
+	return c == '$' || c == '`' || c == '"' || c == '\\' || c == '\n';
+}
+
+// Accumulates the pieces of one word. As long as the pieces are adjacent in
+// the text the word stays a view into it; the first gap moves it into the
+// copy buffer.
+class word_builder {
+public:
+	word_builder(std::unique_ptr<char[]> &storage, std::size_t capacity, std::size_t &used)
+	    : storage_(storage), capacity_(capacity), used_(used) {}
+
+	void append(const char *data, std::size_t size) {
+		if (!started_ || (!copied_ && view_.empty())) {
+			started_ = true;
+			view_ = std::string_view(data, size);
+			return;
+		}
+		if (size == 0)
+			return;
+		if (!copied_ && view_.data() + view_.size() == data) {
+			view_ = std::string_view(view_.data(), view_.size() + size);
+			return;
+		}
+		if (!copied_) {
+			if (storage_ == nullptr)
+				storage_.reset(new char[capacity_]);
+			std::memcpy(storage_.get() + used_, view_.data(), view_.size());
+			view_ = std::string_view(storage_.get() + used_, view_.size());
+			copied_ = true;
+		}
+		std::memcpy(storage_.get() + used_ + view_.size(), data, size);
+		view_ = std::string_view(view_.data(), view_.size() + size);
+	}
+
+	bool started() const noexcept { return started_; }
+
+	// Finishes the word and returns it.
+	std::string_view finish() noexcept {
+		if (copied_)
+			used_ += view_.size();
+		return view_;
+	}
+
+private:
+	std::unique_ptr<char[]> &storage_;
+	std::size_t capacity_;
+	std::size_t &used_;
+	std::string_view view_;
+	bool started_ = false;
+	bool copied_ = false;
+};
+
+[[noreturn]] void throw_quoting(std::size_t offset, const char *what) {
+	throw parse_error(error_code::bad_quoting, offset, what);
+}
+
+} // namespace
+
+bool command_line::copied(std::size_t i) const noexcept {
+	const char *data = args_[i].data();
+	return storage_ != nullptr && data >= storage_.get() && data < storage_.get() + storage_size_;
+}
+
+command_line split_command(std::string_view text) {
+	command_line out;
+	// Unescaped output never exceeds the input, so one buffer of that size
+	// holds every copied word; it is only allocated if one is needed.
+	out.storage_size_ = text.size();
+	std::size_t used = 0;
+	const std::size_t n = text.size();
+	std::size_t pos = 0;
+
+	for (;;) {
+		while (pos < n && is_blank(text[pos]))
+			++pos;
+		if (pos == n)
+			break;
+		if (text[pos] == '#') {
+			const std::size_t eol = text.find('\n', pos);
+			pos = eol == std::string_view::npos ? n : eol;
+			continue;
+		}
+
+		word_builder word(out.storage_, n, used);
+		while (pos < n && !is_blank(text[pos])) {
+			const char c = text[pos];
+			if (c == '\'') {
+				const std::size_t close = text.find('\'', pos + 1);
+				if (close == std::string_view::npos)
+					throw_quoting(pos, "unterminated single quote");
+				word.append(text.data() + pos + 1, close - pos - 1);
+				pos = close + 1;
+			} else if (c == '"') {
+				const std::size_t open = pos;
+				std::size_t piece = ++pos;
+				while (pos < n && text[pos] != '"') {
+					if (text[pos] == '\\' && pos + 1 < n && escapable_in_double_quotes(text[pos + 1])) {
+						word.append(text.data() + piece, pos - piece);
+						if (text[pos + 1] != '\n')
+							word.append(text.data() + pos + 1, 1);
+						pos += 2;
+						piece = pos;
+					} else {
+						++pos;
+					}
+				}
+				if (pos == n)
+					throw_quoting(open, "unterminated double quote");
+				word.append(text.data() + piece, pos - piece);
+				++pos;
+			} else if (c == '\\') {
+				if (pos + 1 == n)
+					throw_quoting(pos, "trailing backslash");
+				if (text[pos + 1] != '\n')
+					word.append(text.data() + pos + 1, 1);
+				pos += 2;
+			} else {
+				const std::size_t start = pos;
+				while (pos < n && !ends_plain_run(text[pos]))
+					++pos;
+				word.append(text.data() + start, pos - start);
+			}
+		}
+		if (word.started())
+			out.args_.push_back(word.finish());
+	}
+	return out;
+}
+
+} // namespace option_parser
@@ -0,0 +1,77 @@
+#include "option_parser/config.hpp"
+
+#include <string>
+#include <utility>
+
+namespace option_parser {
+
+namespace {
+
+// Adds args to the running totals of a joined list and checks them against
+// max_args and max_bytes, as parse would check the whole list.
+void count_args(const std::vector<std::string_view> &args, const parse_limits &limits, std::size_t &count,
+                std::size_t &bytes) {
+	if (args.size() > limits.max_args - count)
+		throw limit_error(limit_kind::args, limits.max_args, limits.max_args,
+		                  "more than " + std::to_string(limits.max_args) + " arguments");
+	if (limits.max_bytes != parse_limits::unlimited) {
+		for (std::size_t i = 0; i < args.size(); ++i) {
+			bytes += args[i].size();
+			if (bytes > limits.max_bytes)
+				throw limit_error(limit_kind::bytes, limits.max_bytes, count + i,
+				                  "arguments exceed " + std::to_string(limits.max_bytes) + " bytes");
+		}
+	}
+	count += args.size();
+}
+
+} // namespace
+
+std::shared_ptr<const config> config::make(const spec &options, std::vector<std::string> args,
+                                           std::uint64_t generation, const parse_limits &limits) {
+	return std::shared_ptr<const config>(new config(options, {}, std::move(args), generation, limits));
+}
+
+std::shared_ptr<const config::source> config::read(const spec &options, std::string text,
+                                                   const parse_limits &limits) {
+	auto out = std::make_shared<source>();
+	out->text = std::move(text);
+	out->words = split_command(out->text);
+	out->tokens = tokenize(options, arg_list(out->words.args()), limits);
+	return out;
+}
+
+config::config(const spec &options, std::vector<std::shared_ptr<const source>> sources,
+               std::vector<std::string> arguments, std::uint64_t generation, const parse_limits &limits)
+    : sources_(std::move(sources)), arguments_(std::move(arguments)), args_(arguments_.begin(), arguments_.end()),
+      generation_(generation), values_(parse_all(options, limits)) {
+	values_.validate();
+}
+
+// Only arguments are tokenized here; the sources' tokens are copied with
+// their indices offset to number the joined list. Each piece was checked
+// against max_args and max_bytes alone, so the joined list is checked here.
+result config::parse_all(const spec &options, const parse_limits &limits) const {
+	std::size_t count = 0;
+	std::size_t bytes = 0;
+	for (const auto &source : sources_)
+		count_args(source->words.args(), limits, count, bytes);
+	count_args(args_, limits, count, bytes);
+
+	std::vector<token> tokens;
+	std::size_t offset = 0;
+	for (const auto &source : sources_) {
+		for (token tok : source->tokens) {
+			tok.index += offset;
+			tokens.push_back(tok);
+		}
+		offset += source->words.args().size();
+	}
+	for (token tok : tokenize(options, arg_list(args_), limits)) {
+		tok.index += offset;
+		tokens.push_back(tok);
+	}
+	return parse_tokens(options, tokens, limits);
+}
+
+} // namespace option_parser
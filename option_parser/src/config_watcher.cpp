@@ -0,0 +1,206 @@
+#include "option_parser/config_watcher.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace option_parser {
+
+namespace {
+
+// Events that can change what a path reads: writes in place, and files
+// created, renamed over or removed.
+constexpr std::uint32_t watched_events =
+    IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+[[noreturn]] void fail(const char *what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+config_watcher::config_watcher(const spec &options, std::vector<std::string> paths, watch_options settings)
+    : spec_(&options), paths_(std::move(paths)), dirty_(paths_.size(), false), settings_(std::move(settings)) {
+	inotify_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_ < 0)
+		fail("inotify_init1");
+	if (::pipe2(wake_, O_NONBLOCK | O_CLOEXEC) != 0) {
+		::close(inotify_);
+		fail("pipe2");
+	}
+
+	// Directories are watched rather than the files, so a file replaced by
+	// rename, as editors and deploy tools do, is still seen.
+	try {
+		for (const std::string &path : paths_) {
+			const std::size_t slash = path.rfind('/');
+			const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+			names_.push_back(slash == std::string::npos ? path : path.substr(slash + 1));
+			std::size_t index = 0;
+			while (index < directories_.size() && directories_[index].path != dir)
+				++index;
+			if (index == directories_.size()) {
+				const int wd = ::inotify_add_watch(inotify_, dir.c_str(), watched_events | IN_ONLYDIR);
+				if (wd < 0)
+					fail("inotify_add_watch");
+				directories_.push_back({wd, dir});
+			}
+			directory_of_.push_back(index);
+		}
+
+		std::vector<std::shared_ptr<const config::source>> sources;
+		for (std::size_t i = 0; i < paths_.size(); ++i)
+			sources.push_back(config::read(options, read_text(i), settings_.limits));
+		std::shared_ptr<const config> first(new config(options, std::move(sources), {}, 1, settings_.limits));
+		published_.emplace(std::move(first), settings_.max_readers);
+	} catch (...) {
+		::close(inotify_);
+		::close(wake_[0]);
+		::close(wake_[1]);
+		throw;
+	}
+}
+
+config_watcher::~config_watcher() {
+	stop();
+	::close(inotify_);
+	::close(wake_[0]);
+	::close(wake_[1]);
+}
+
+bool config_watcher::poll(std::chrono::milliseconds timeout) {
+	if (!wait(timeout))
+		return false;
+	drain();
+	while (wait(settings_.debounce))
+		drain();
+	return reload();
+}
+
+void config_watcher::start() {
+	if (thread_.joinable())
+		throw std::logic_error("config watcher is already running");
+	thread_ = std::thread([this] {
+		while (!stopping_.load(std::memory_order_acquire)) {
+			try {
+				poll(std::chrono::hours(1));
+			} catch (...) {
+				// Without on_error a failed reload is dropped; the previous config stays.
+			}
+		}
+	});
+}
+
+void config_watcher::stop() {
+	if (!thread_.joinable())
+		return;
+	stopping_.store(true, std::memory_order_release);
+	const char byte = 0;
+	while (::write(wake_[1], &byte, 1) < 0 && errno == EINTR) {
+	}
+	thread_.join();
+	char buffer[64];
+	while (::read(wake_[0], buffer, sizeof buffer) > 0) {
+	}
+	stopping_.store(false, std::memory_order_release);
+}
+
+std::string config_watcher::read_text(std::size_t i) const {
+	std::optional<std::string> text = settings_.load(paths_[i], settings_.limits.max_response_bytes);
+	if (!text)
+		throw parse_error(error_code::response_file, 0, "cannot read config file " + paths_[i]);
+	if (text->size() > settings_.limits.max_response_bytes)
+		throw limit_error(limit_kind::response_bytes, settings_.limits.max_response_bytes, 0,
+		                  "config file " + paths_[i] + " exceeds " +
+		                      std::to_string(settings_.limits.max_response_bytes) + " bytes");
+	return std::move(*text);
+}
+
+// Whether inotify has events within timeout; false as well once stop() was called.
+bool config_watcher::wait(std::chrono::milliseconds timeout) const {
+	pollfd fds[2] = {{inotify_, POLLIN, 0}, {wake_[0], POLLIN, 0}};
+	using std::chrono::milliseconds;
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	for (;;) {
+		const milliseconds::rep left =
+		    std::chrono::duration_cast<milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		const int ready = ::poll(fds, 2, static_cast<int>(std::clamp<milliseconds::rep>(left, 0, INT_MAX)));
+		if (ready < 0 && errno == EINTR)
+			continue;
+		if (ready < 0)
+			fail("poll");
+		return ready > 0 && (fds[1].revents & POLLIN) == 0 && (fds[0].revents & POLLIN) != 0;
+	}
+}
+
+// Reads every pending event and marks the files they name dirty.
+void config_watcher::drain() {
+	alignas(inotify_event) char buffer[16 * 1024];
+	for (;;) {
+		const ssize_t size = ::read(inotify_, buffer, sizeof buffer);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size < 0 && errno == EAGAIN)
+			return;
+		if (size <= 0)
+			fail("read inotify");
+		for (const char *at = buffer; at < buffer + size;) {
+			const auto *event = reinterpret_cast<const inotify_event *>(at);
+			at += sizeof(inotify_event) + event->len;
+			if (event->mask & IN_Q_OVERFLOW) {
+				dirty_.assign(paths_.size(), true);
+				continue;
+			}
+			const std::string_view name = event->len ? std::string_view(event->name) : std::string_view();
+			for (std::size_t i = 0; i < paths_.size(); ++i)
+				if (directories_[directory_of_[i]].wd == event->wd && names_[i] == name)
+					dirty_[i] = true;
+		}
+	}
+}
+
+// Re-reads the dirty files and publishes their parse if any of them changed.
+// After a failure the files stay dirty, so the next reload reads them again
+// rather than publishing the last good text of a file that has since changed.
+bool config_watcher::reload() {
+	const std::shared_ptr<const config> before = published_->current();
+	std::shared_ptr<const config> after;
+	try {
+		std::vector<std::shared_ptr<const config::source>> sources = before->sources_;
+		bool changed = false;
+		for (std::size_t i = 0; i < paths_.size(); ++i) {
+			if (!dirty_[i])
+				continue;
+			std::string text = read_text(i);
+			if (text == sources[i]->text)
+				continue;
+			sources[i] = config::read(*spec_, std::move(text), settings_.limits);
+			changed = true;
+		}
+		if (changed)
+			after.reset(new config(*spec_, std::move(sources), {}, before->generation_ + 1, settings_.limits));
+	} catch (...) {
+		if (!settings_.on_error)
+			throw;
+		settings_.on_error(std::current_exception());
+		return false;
+	}
+	if (after)
+		published_->install(after);
+	dirty_.assign(paths_.size(), false);
+	if (!after)
+		return false;
+	if (settings_.on_publish)
+		settings_.on_publish(before, after);
+	return true;
+}
+
+} // namespace option_parser
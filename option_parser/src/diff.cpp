@@ -0,0 +1,134 @@
+#include "option_parser/diff.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace option_parser {
+
+namespace {
+
+bool same_floating(double a, double b) noexcept {
+	return a == b || (a != a && b != b);
+}
+
+bool same_map(const flat_string_map &a, const flat_string_map &b) noexcept {
+	if (a.size() != b.size())
+		return false;
+	for (const flat_string_map::entry &entry : a) {
+		const flat_string_map::entry *other = b.find(entry.key);
+		if (other == nullptr || other->value != entry.value)
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+bool change_set::contains(option_id id) const noexcept {
+	return std::binary_search(ids_.begin(), ids_.end(), id);
+}
+
+change_set diff(const result &before, const result &after) {
+	if (before.spec_ != after.spec_)
+		throw std::invalid_argument("only results of the same spec can be compared");
+	change_set changes;
+	for (std::size_t i = 0; i < before.slots_.size(); ++i) {
+		const auto id = static_cast<option_id>(i);
+		const value_kind kind = before.spec_->def(id).kind;
+		const value_slot &a = before.checked_slot(id, kind);
+		const value_slot &b = after.checked_slot(id, kind);
+		bool same = true;
+		switch (kind) {
+		case value_kind::flag:
+			same = a.count == b.count;
+			break;
+		case value_kind::string:
+			same = a.text == b.text;
+			break;
+		case value_kind::integer:
+		case value_kind::choice:
+			same = a.integer == b.integer;
+			break;
+		case value_kind::floating:
+			same = same_floating(a.floating, b.floating);
+			break;
+		case value_kind::list:
+			same = a.count == b.count &&
+			       std::equal(before.list_values_.begin() + a.integer, before.list_values_.begin() + a.integer + a.count,
+			                  after.list_values_.begin() + b.integer);
+			break;
+		case value_kind::map:
+			same = same_map(before.maps_[static_cast<std::size_t>(a.integer)],
+			                after.maps_[static_cast<std::size_t>(b.integer)]);
+			break;
+		}
+		if (!same)
+			changes.ids_.push_back(id);
+	}
+	return changes;
+}
+
+change_notifier::subscription change_notifier::subscribe(option_id id, callback fn) {
+	return subscribe(std::vector<option_id>{id}, std::move(fn));
+}
+
+change_notifier::subscription change_notifier::subscribe(std::vector<option_id> ids, callback fn) {
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	const subscription which = subscribers_.size();
+	if (!ids.empty() && ids.back() >= by_option_.size())
+		by_option_.resize(ids.back() + std::size_t{1});
+	subscribers_.push_back({std::move(fn), ids});
+	for (const option_id id : subscribers_.back().ids)
+		by_option_[id].push_back(which);
+	return which;
+}
+
+change_notifier::subscription change_notifier::subscribe(const option_group &group, callback fn) {
+	std::vector<option_id> ids;
+	group.for_each_option([&](option_id id) { ids.push_back(id); });
+	return subscribe(std::move(ids), std::move(fn));
+}
+
+void change_notifier::unsubscribe(subscription which) noexcept {
+	if (which >= subscribers_.size() || !subscribers_[which].active)
+		return;
+	subscriber &dropped = subscribers_[which];
+	for (const option_id id : dropped.ids) {
+		std::vector<subscription> &list = by_option_[id];
+		list.erase(std::find(list.begin(), list.end(), which));
+	}
+	dropped.active = false;
+	dropped.ids.clear();
+	if (!publishing_)
+		dropped.fn = nullptr; // else it may be the callback running now
+}
+
+change_set change_notifier::publish(const result &before, const result &after) {
+	if (publishing_)
+		throw std::logic_error("publish() called from a change_notifier callback");
+	const change_set changes = diff(before, after);
+	std::vector<subscription> due;
+	for (const option_id id : changes)
+		if (id < by_option_.size())
+			due.insert(due.end(), by_option_[id].begin(), by_option_[id].end());
+	std::sort(due.begin(), due.end());
+	due.erase(std::unique(due.begin(), due.end()), due.end());
+
+	struct release_dropped {
+		change_notifier &self;
+		~release_dropped() {
+			self.publishing_ = false;
+			for (subscriber &entry : self.subscribers_)
+				if (!entry.active)
+					entry.fn = nullptr;
+		}
+	} guard{*this};
+	publishing_ = true;
+	for (const subscription which : due)
+		if (subscribers_[which].active)
+			subscribers_[which].fn(after, changes);
+	return changes;
+}
+
+} // namespace option_parser
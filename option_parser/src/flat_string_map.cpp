@@ -0,0 +1,132 @@
+#include "option_parser/flat_string_map.hpp"
+
+#include <cstring>
+#include <random>
+
+namespace option_parser {
+
+namespace {
+
+// SipHash-1-3 under a per-process random key. Keys come from untrusted
+// arguments, and with a fixed hash an attacker can pick keys that all land
+// in one probe run, turning n inserts into O(n^2) work.
+struct sip_key {
+	std::uint64_t k0;
+	std::uint64_t k1;
+};
+
+const sip_key &process_key() {
+	static const sip_key key = [] {
+		std::random_device random;
+		const auto draw = [&] { return (std::uint64_t{random()} << 32) ^ random(); };
+		return sip_key{draw(), draw()};
+	}();
+	return key;
+}
+
+inline std::uint64_t rotl(std::uint64_t x, int b) noexcept {
+	return (x << b) | (x >> (64 - b));
+}
+
+inline void sip_round(std::uint64_t &v0, std::uint64_t &v1, std::uint64_t &v2, std::uint64_t &v3) noexcept {
+	v0 += v1;
+	v1 = rotl(v1, 13);
+	v1 ^= v0;
+	v0 = rotl(v0, 32);
+	v2 += v3;
+	v3 = rotl(v3, 16);
+	v3 ^= v2;
+	v0 += v3;
+	v3 = rotl(v3, 21);
+	v3 ^= v0;
+	v2 += v1;
+	v1 = rotl(v1, 17);
+	v1 ^= v2;
+	v2 = rotl(v2, 32);
+}
+
+std::uint64_t hash_key(std::string_view data) noexcept {
+	const sip_key &key = process_key();
+	std::uint64_t v0 = key.k0 ^ 0x736f6d6570736575ULL;
+	std::uint64_t v1 = key.k1 ^ 0x646f72616e646f6dULL;
+	std::uint64_t v2 = key.k0 ^ 0x6c7967656e657261ULL;
+	std::uint64_t v3 = key.k1 ^ 0x7465646279746573ULL;
+
+	const std::size_t whole = data.size() & ~std::size_t{7};
+	for (std::size_t i = 0; i < whole; i += 8) {
+		std::uint64_t m;
+		std::memcpy(&m, data.data() + i, 8);
+		v3 ^= m;
+		sip_round(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+	std::uint64_t last = std::uint64_t{data.size()} << 56;
+	for (std::size_t i = whole; i < data.size(); ++i)
+		last |= std::uint64_t{static_cast<unsigned char>(data[i])} << (8 * (i - whole));
+	v3 ^= last;
+	sip_round(v0, v1, v2, v3);
+	v0 ^= last;
+
+	v2 ^= 0xff;
+	sip_round(v0, v1, v2, v3);
+	sip_round(v0, v1, v2, v3);
+	sip_round(v0, v1, v2, v3);
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// Keeps the table at most half full.
+std::size_t buckets_for(std::size_t n) {
+	std::size_t buckets = 8;
+	while (buckets < n * 2)
+		buckets *= 2;
+	return buckets;
+}
+
+} // namespace
+
+void flat_string_map::reserve(std::size_t n) {
+	entries_.reserve(n);
+	if (index_.size() < buckets_for(n))
+		rehash(buckets_for(n));
+}
+
+std::pair<flat_string_map::entry *, bool> flat_string_map::insert(std::string_view key, std::string_view value) {
+	if (index_.empty() || (entries_.size() + 1) * 2 > index_.size())
+		rehash(buckets_for(entries_.size() + 1));
+
+	const std::size_t slot = probe(key);
+	if (index_[slot] != empty_slot)
+		return {&entries_[index_[slot] - 1], false};
+	entries_.push_back({key, value});
+	index_[slot] = static_cast<std::uint32_t>(entries_.size());
+	return {&entries_.back(), true};
+}
+
+const flat_string_map::entry *flat_string_map::find(std::string_view key) const noexcept {
+	if (index_.empty())
+		return nullptr;
+	const std::uint32_t found = index_[probe(key)];
+	return found == empty_slot ? nullptr : &entries_[found - 1];
+}
+
+// Bucket holding key, or the empty bucket where it would go.
+std::size_t flat_string_map::probe(std::string_view key) const noexcept {
+	const std::size_t mask = index_.size() - 1;
+	std::size_t slot = hash_key(key) & mask;
+	while (index_[slot] != empty_slot && entries_[index_[slot] - 1].key != key)
+		slot = (slot + 1) & mask;
+	return slot;
+}
+
+void flat_string_map::rehash(std::size_t buckets) {
+	index_.assign(buckets, empty_slot);
+	const std::size_t mask = buckets - 1;
+	for (std::size_t i = 0; i < entries_.size(); ++i) {
+		std::size_t slot = hash_key(entries_[i].key) & mask;
+		while (index_[slot] != empty_slot)
+			slot = (slot + 1) & mask;
+		index_[slot] = static_cast<std::uint32_t>(i + 1);
+	}
+}
+
+} // namespace option_parser
@@ -1,5 +1,774 @@
 #include "option_parser/option_parser.hpp"
+#include "option_parser/pattern.hpp"
+#include "option_parser/utf8.hpp"
 
-int test() {
-	return 42;
-}
\ No newline at end of file
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+
+namespace option_parser {
+
+namespace {
+
+std::string display_name(detail::option_label label) {
+	return label.long_name.empty() ? std::string{'-', label.short_name} : "--" + std::string(label.long_name);
+}
+
+detail::option_label label_of(const option_def &def) noexcept {
+	return {def.long_name, def.short_name};
+}
+
+std::string display_name(const option_def &def) {
+	return display_name(label_of(def));
+}
+
+[[noreturn]] void throw_invalid(const token &tok, detail::option_label label, std::string_view why) {
+	throw parse_error(error_code::invalid_value, tok.index,
+	                  "invalid value '" + std::string(tok.value) + "' for option " + display_name(label) + ": " +
+	                      std::string(why));
+}
+
+std::string deprecation(const token &tok, const option_def &def) {
+	return detail::deprecation(tok, label_of(def));
+}
+
+void check_pattern(const token &tok, const option_def &def) {
+	if (def.pattern)
+		detail::check_pattern(tok, label_of(def), *def.pattern);
+}
+
+// Number of key=value pairs one occurrence of a map option carries.
+std::uint32_t map_pairs(const option_def &def, std::string_view value) {
+	if (def.separator == '\0')
+		return 1;
+	return 1 + static_cast<std::uint32_t>(std::count(value.begin(), value.end(), def.separator));
+}
+
+// Checks the argument count and total length against limits without
+// allocating; the length is only measured when it is bounded.
+void check_size(arg_list args, const parse_limits &limits) {
+	if (args.size() > limits.max_args)
+		throw limit_error(limit_kind::args, limits.max_args, limits.max_args,
+		                  "more than " + std::to_string(limits.max_args) + " arguments");
+	if (limits.max_bytes == parse_limits::unlimited)
+		return;
+	std::size_t bytes = 0;
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		bytes += args[i].size();
+		if (bytes > limits.max_bytes)
+			throw limit_error(limit_kind::bytes, limits.max_bytes, i,
+			                  "arguments exceed " + std::to_string(limits.max_bytes) + " bytes");
+	}
+}
+
+// Adds the list values or map pairs tok carries to counts; returns whether
+// it carried any.
+bool count_values(const spec &options, const token &tok, std::vector<std::uint32_t> &counts,
+                  const parse_limits &limits) {
+	if (tok.kind != token::type::option)
+		return false;
+	const option_def &def = options.def(tok.id);
+	if (def.kind != value_kind::list && def.kind != value_kind::map)
+		return false;
+	counts[tok.id] += def.kind == value_kind::map ? map_pairs(def, tok.value) : 1;
+	if (counts[tok.id] > limits.max_values)
+		throw limit_error(limit_kind::values, limits.max_values, tok.index, "too many values for " + display_name(def));
+	return true;
+}
+
+result apply_tokens(const spec &options, const std::vector<token> &tokens, const std::vector<std::uint32_t> &counts,
+                    bool has_counts) {
+	result parsed(options);
+	if (has_counts)
+		parsed.reserve_values(counts);
+	for (const token &t : tokens)
+		parsed.apply(t);
+	return parsed;
+}
+
+std::int64_t to_integer(const token &tok, const option_def &def) {
+	return detail::to_integer(tok, label_of(def));
+}
+
+double to_floating(const token &tok, const option_def &def) {
+	return detail::to_floating(tok, label_of(def));
+}
+
+const choice_entry &to_choice(const token &tok, const option_def &def) {
+	return detail::to_choice(tok, label_of(def), def.choices.data(), def.choices.size(), def.match);
+}
+
+// The occurrence a slot holds, as the token it came from.
+token pending_token(option_id id, const value_slot &slot) {
+	token tok;
+	tok.kind = token::type::option;
+	tok.id = id;
+	tok.value = slot.text;
+	tok.index = slot.index;
+	return tok;
+}
+
+// Throws the parse_error converting tok would, keeping nothing.
+void check_value(const token &tok, const option_def &def) {
+	switch (def.kind) {
+	case value_kind::string:
+		check_pattern(tok, def);
+		break;
+	case value_kind::integer:
+		to_integer(tok, def);
+		break;
+	case value_kind::floating:
+		to_floating(tok, def);
+		break;
+	case value_kind::choice:
+		to_choice(tok, def);
+		break;
+	default:
+		break;
+	}
+}
+
+// Splits the next key=value pair of a map occurrence off rest. Returns
+// whether more pairs follow.
+bool take_pair(const token &tok, detail::option_label label, char separator, std::string_view &rest,
+               std::string_view &key, std::string_view &value) {
+	const std::size_t end = separator == '\0' ? std::string_view::npos : rest.find(separator);
+	const std::string_view pair = rest.substr(0, end);
+	const std::size_t eq = pair.find('=');
+	if (eq == 0 || eq == std::string_view::npos)
+		throw_invalid(tok, label, "expected key=value");
+	key = pair.substr(0, eq);
+	value = pair.substr(eq + 1);
+	if (end == std::string_view::npos)
+		return false;
+	rest.remove_prefix(end + 1);
+	return true;
+}
+
+bool take_pair(const token &tok, const option_def &def, std::string_view &rest, std::string_view &key,
+               std::string_view &value) {
+	return take_pair(tok, label_of(def), def.separator, rest, key, value);
+}
+
+void insert_pairs(const token &tok, const option_def &def, flat_string_map &map) {
+	detail::insert_pairs(tok, label_of(def), def.separator, def.duplicates, map);
+}
+
+} // namespace
+
+namespace detail {
+
+std::int64_t to_integer(const token &tok, option_label label) {
+	const char *first = tok.value.data();
+	const char *last = first + tok.value.size();
+	std::int64_t value = 0;
+	const auto [ptr, ec] = std::from_chars(first, last, value);
+	if (ec != std::errc() || ptr != last || first == last)
+		throw_invalid(tok, label, "expected an integer");
+	return value;
+}
+
+double to_floating(const token &tok, option_label label) {
+	const char *first = tok.value.data();
+	const char *last = first + tok.value.size();
+	double value = 0.0;
+	const auto [ptr, ec] = std::from_chars(first, last, value);
+	if (ec != std::errc() || ptr != last || first == last)
+		throw_invalid(tok, label, "expected a number");
+	return value;
+}
+
+const choice_entry &to_choice(const token &tok, option_label label, const choice_entry *entries, std::size_t size,
+                              choice_match match) {
+	const choice_lookup found = find_choice(entries, size, tok.value, match);
+	if (found.entry == nullptr)
+		throw_invalid(tok, label, found.candidates > 1 ? "ambiguous choice" : "unknown choice");
+	return *found.entry;
+}
+
+void check_pattern(const token &tok, option_label label, const string_pattern &pattern) {
+	if (!pattern.matches(tok.value))
+		throw_invalid(tok, label, "does not match " + pattern.source());
+}
+
+// Adds the pairs of one map occurrence, applying the duplicate key policy.
+void insert_pairs(const token &tok, option_label label, char separator, duplicate_key duplicates,
+                  flat_string_map &map) {
+	std::string_view rest = tok.value;
+	std::string_view key;
+	std::string_view value;
+	bool more = true;
+	while (more) {
+		more = take_pair(tok, label, separator, rest, key, value);
+		const auto [entry, inserted] = map.insert(key, value);
+		if (!inserted) {
+			if (duplicates == duplicate_key::reject)
+				throw_invalid(tok, label, "duplicate key '" + std::string(key) + "'");
+			if (duplicates == duplicate_key::last_wins)
+				entry->value = value;
+		}
+	}
+}
+
+std::string deprecation(const token &tok, option_label label) {
+	const std::string used = tok.name.size() == 1 ? "-" + std::string(tok.name) : std::string(tok.name);
+	return "option " + used + " is deprecated; use " + display_name(label);
+}
+
+void check_utf8(std::string_view arg, std::size_t index) {
+	const std::size_t bad = find_invalid_utf8(arg);
+	if (bad != std::string_view::npos)
+		throw parse_error(error_code::invalid_encoding, index,
+		                  "argument " + std::to_string(index) + " is not valid UTF-8 at byte " + std::to_string(bad));
+}
+
+} // namespace detail
+
+parse_error::parse_error(error_code code, std::size_t index, const std::string &message)
+    : std::runtime_error(message), code_(code), index_(index) {}
+
+limit_error::limit_error(limit_kind which, std::size_t limit, std::size_t index, const std::string &message)
+    : parse_error(error_code::limit_exceeded, index, message), which_(which), limit_(limit) {}
+
+option_handle<bool> spec::add_flag(std::string long_name, char short_name) {
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::flag;
+	return option_handle<bool>(add(std::move(def)));
+}
+
+option_handle<std::string_view> spec::add_string(std::string long_name, char short_name, std::string default_value) {
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::string;
+	def.default_text = std::move(default_value);
+	return option_handle<std::string_view>(add(std::move(def)));
+}
+
+option_handle<std::string_view> spec::add_pattern(std::string long_name, char short_name, std::string_view pattern,
+                                                  std::string default_value) {
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::string;
+	def.default_text = std::move(default_value);
+	for (const option_def &other : defs_) {
+		if (other.pattern && other.pattern->source() == pattern) {
+			def.pattern = other.pattern;
+			break;
+		}
+	}
+	if (!def.pattern)
+		def.pattern = std::make_shared<const string_pattern>(pattern);
+	if (!def.default_text.empty() && !def.pattern->matches(def.default_text))
+		throw std::invalid_argument("default of --" + def.long_name + " does not match its pattern");
+	return option_handle<std::string_view>(add(std::move(def)));
+}
+
+option_handle<std::int64_t> spec::add_int(std::string long_name, char short_name, std::int64_t default_value) {
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::integer;
+	def.default_integer = default_value;
+	return option_handle<std::int64_t>(add(std::move(def)));
+}
+
+option_handle<double> spec::add_double(std::string long_name, char short_name, double default_value) {
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::floating;
+	def.default_floating = default_value;
+	return option_handle<double>(add(std::move(def)));
+}
+
+option_handle<string_span> spec::add_list(std::string long_name, char short_name) {
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::list;
+	return option_handle<string_span>(add(std::move(def)));
+}
+
+option_handle<flat_string_map> spec::add_map(std::string long_name, char short_name, char separator, duplicate_key duplicates) {
+	if (separator == '=')
+		throw std::invalid_argument("'=' separates keys from values and cannot separate pairs");
+	option_def def;
+	def.long_name = std::move(long_name);
+	def.short_name = short_name;
+	def.kind = value_kind::map;
+	def.separator = separator;
+	def.duplicates = duplicates;
+	return option_handle<flat_string_map>(add(std::move(def)));
+}
+
+option_id spec::add(option_def def) {
+	check_names(def.long_name, def.short_name);
+	if (def.long_name.empty() && def.short_name == '\0')
+		throw std::invalid_argument("an option needs a long or a short name");
+
+	if (defs_.size() >= deprecated_short - 1)
+		throw std::length_error("too many options");
+	const auto id = static_cast<option_id>(defs_.size());
+	index_names(def.long_name, def.short_name, {id, false});
+	if (!def.long_name.empty())
+		add_to_groups(def.long_name, id);
+	defs_.push_back(std::move(def));
+	return id;
+}
+
+void spec::add_alias(option_id id, std::string long_name, char short_name, alias_kind kind) {
+	check_names(long_name, short_name);
+	if (id >= defs_.size())
+		throw std::out_of_range("no option with id " + std::to_string(id));
+	if (long_name.empty() && short_name == '\0')
+		throw std::invalid_argument("an alias needs a long or a short name");
+	index_names(std::move(long_name), short_name, {id, kind == alias_kind::deprecated});
+}
+
+void spec::require_utf8(bool required) {
+	if (sealed_)
+		throw std::logic_error("a sealed spec cannot be changed");
+	utf8_ = required;
+}
+
+void spec::accept_bytes(option_id id) {
+	if (sealed_)
+		throw std::logic_error("a sealed spec cannot be changed");
+	option_def &def = defs_.at(id);
+	if (def.kind != value_kind::string && def.kind != value_kind::list && def.kind != value_kind::map)
+		throw std::invalid_argument("only string, list and map options can accept bytes, not " +
+		                            option_parser::display_name(def));
+	def.accepts_bytes = true;
+}
+
+void spec::accept_positional_bytes(bool accepted) {
+	if (sealed_)
+		throw std::logic_error("a sealed spec cannot be changed");
+	positional_bytes_ = accepted;
+}
+
+void spec::check_names(const std::string &long_name, char short_name) const {
+	if (sealed_)
+		throw std::logic_error("options cannot be added to a sealed spec");
+	if (!long_name.empty() && find_long(long_name))
+		throw std::invalid_argument("duplicate option --" + long_name);
+	if (!is_valid_utf8(long_name))
+		throw std::invalid_argument("long option names must be valid UTF-8");
+	if (short_name == '\0')
+		return;
+	if (short_name <= ' ' || short_name > '~' || short_name == '-')
+		throw std::invalid_argument("short option names must be printable ASCII other than '-'");
+	if (find_short(short_name))
+		throw std::invalid_argument(std::string("duplicate option -") + short_name);
+}
+
+void spec::index_names(std::string long_name, char short_name, name_match match) {
+	if (!long_name.empty()) {
+		long_index_.emplace_back().push_back({std::move(long_name), match});
+		compact_long_index();
+	}
+	if (short_name != '\0')
+		short_table_[static_cast<unsigned char>(short_name)] = (match.id + 1) | (match.deprecated ? deprecated_short : 0);
+}
+
+// Merges the last two segments while the last is at least as large as the
+// one before, as in a binary counter: every entry is moved O(log n) times
+// and sizes at least halve from one segment to the next.
+void spec::compact_long_index() {
+	while (long_index_.size() > 1) {
+		std::vector<long_entry> &last = long_index_.back();
+		std::vector<long_entry> &prev = long_index_[long_index_.size() - 2];
+		if (prev.size() > last.size())
+			break;
+		std::vector<long_entry> merged;
+		merged.reserve(prev.size() + last.size());
+		std::merge(std::make_move_iterator(prev.begin()), std::make_move_iterator(prev.end()),
+		           std::make_move_iterator(last.begin()), std::make_move_iterator(last.end()),
+		           std::back_inserter(merged), [](const long_entry &a, const long_entry &b) { return a.name < b.name; });
+		long_index_.pop_back();
+		long_index_.back() = std::move(merged);
+	}
+}
+
+merged_options spec::merge(spec other) {
+	if (sealed_)
+		throw std::logic_error("options cannot be added to a sealed spec");
+	for (const std::vector<long_entry> &segment : other.long_index_)
+		for (const long_entry &entry : segment)
+			if (find_long(entry.name))
+				throw std::invalid_argument("duplicate option --" + entry.name);
+	for (std::size_t c = 0; c < short_table_.size(); ++c)
+		if (short_table_[c] != 0 && other.short_table_[c] != 0)
+			throw std::invalid_argument(std::string("duplicate option -") + static_cast<char>(c));
+	if (defs_.size() + other.defs_.size() >= deprecated_short - 1)
+		throw std::length_error("too many options");
+
+	const auto base = static_cast<option_id>(defs_.size());
+	const std::size_t merged = other.defs_.size();
+	std::vector<long_entry> added;
+	for (std::vector<long_entry> &segment : other.long_index_) {
+		for (long_entry &entry : segment) {
+			entry.match.id += base;
+			added.push_back(std::move(entry));
+		}
+	}
+	std::sort(added.begin(), added.end(), [](const long_entry &a, const long_entry &b) { return a.name < b.name; });
+	defs_.reserve(defs_.size() + other.defs_.size());
+
+	if (!added.empty()) {
+		long_index_.push_back(std::move(added));
+		compact_long_index();
+	}
+	for (std::size_t c = 0; c < short_table_.size(); ++c)
+		if (other.short_table_[c] != 0)
+			short_table_[c] = other.short_table_[c] + base;
+	for (option_def &def : other.defs_) {
+		if (!def.long_name.empty())
+			add_to_groups(def.long_name, static_cast<option_id>(defs_.size()));
+		defs_.push_back(std::move(def));
+	}
+	return merged_options(base, merged);
+}
+
+void spec::add_to_groups(std::string_view long_name, option_id id) {
+	std::uint32_t node = 0;
+	for (;;) {
+		const std::size_t dot = long_name.find('.');
+		const std::string_view segment = long_name.substr(0, dot);
+		std::uint32_t prev = no_node;
+		std::uint32_t next = groups_[node].first_child;
+		while (next != no_node && groups_[next].segment < segment) {
+			prev = next;
+			next = groups_[next].next_sibling;
+		}
+		if (next == no_node || groups_[next].segment != segment) {
+			group_node child;
+			child.segment = std::string(segment);
+			child.next_sibling = next;
+			groups_.push_back(std::move(child));
+			next = static_cast<std::uint32_t>(groups_.size() - 1);
+			(prev == no_node ? groups_[node].first_child : groups_[prev].next_sibling) = next;
+		}
+		node = next;
+		if (dot == std::string_view::npos)
+			break;
+		long_name.remove_prefix(dot + 1);
+	}
+	groups_[node].option = id;
+}
+
+std::optional<name_match> spec::resolve_long(std::string_view name) const noexcept {
+	for (const std::vector<long_entry> &segment : long_index_) {
+		const auto pos = std::lower_bound(segment.begin(), segment.end(), name,
+		                                  [](const long_entry &lhs, std::string_view rhs) { return lhs.name < rhs; });
+		if (pos != segment.end() && pos->name == name)
+			return pos->match;
+	}
+	return std::nullopt;
+}
+
+std::optional<name_match> spec::resolve_short(char name) const noexcept {
+	const auto code = static_cast<unsigned char>(name);
+	const std::uint32_t entry = code < short_table_.size() ? short_table_[code] : 0;
+	if (entry == 0)
+		return std::nullopt;
+	return name_match{(entry & ~deprecated_short) - 1, (entry & deprecated_short) != 0};
+}
+
+std::optional<option_id> spec::find_long(std::string_view name) const noexcept {
+	if (const auto found = resolve_long(name))
+		return found->id;
+	return std::nullopt;
+}
+
+std::optional<option_id> spec::find_short(char name) const noexcept {
+	if (const auto found = resolve_short(name))
+		return found->id;
+	return std::nullopt;
+}
+
+std::string spec::display_name(option_id id) const {
+	return option_parser::display_name(defs_.at(id));
+}
+
+option_id spec::id(std::string_view long_name) const {
+	if (const auto found = find_long(long_name))
+		return *found;
+	throw std::out_of_range("no option named --" + std::string(long_name));
+}
+
+option_group::iterator &option_group::iterator::operator++() noexcept {
+	node_ = options_->groups_[node_].next_sibling;
+	return *this;
+}
+
+std::string_view option_group::name() const noexcept {
+	return options_->groups_[node_].segment;
+}
+
+std::optional<option_id> option_group::option() const noexcept {
+	const option_id id = options_->groups_[node_].option;
+	if (id == spec::no_option)
+		return std::nullopt;
+	return id;
+}
+
+option_group::iterator option_group::begin() const noexcept {
+	return {options_, options_->groups_[node_].first_child};
+}
+
+option_group::iterator option_group::end() const noexcept {
+	return {options_, spec::no_node};
+}
+
+std::optional<option_group> option_group::child(std::string_view segment) const noexcept {
+	for (const option_group group : *this) {
+		if (group.name() == segment)
+			return group;
+		if (group.name() > segment)
+			break;
+	}
+	return std::nullopt;
+}
+
+std::optional<option_group> option_group::find(std::string_view path) const noexcept {
+	std::optional<option_group> group = *this;
+	while (group && !path.empty()) {
+		const std::size_t dot = path.find('.');
+		group = group->child(path.substr(0, dot));
+		path.remove_prefix(dot == std::string_view::npos ? path.size() : dot + 1);
+	}
+	return group;
+}
+
+template class basic_tokenizer<spec>;
+
+result::result(const spec &options) : spec_(&options), slots_(options.size()) {
+	for (std::size_t i = 0; i < slots_.size(); ++i) {
+		const option_def &def = options.def(static_cast<option_id>(i));
+		slots_[i].text = def.default_text;
+		slots_[i].integer = def.default_integer;
+		slots_[i].floating = def.default_floating;
+		if (def.kind == value_kind::map) {
+			slots_[i].integer = static_cast<std::int64_t>(maps_.size());
+			maps_.emplace_back();
+		}
+	}
+}
+
+void result::reserve_values(const std::vector<std::uint32_t> &counts) {
+	if (!list_values_.empty())
+		throw std::logic_error("value storage is already reserved");
+	std::size_t total = 0;
+	for (std::size_t i = 0; i < slots_.size() && i < counts.size(); ++i) {
+		const value_kind kind = spec_->def(static_cast<option_id>(i)).kind;
+		if (kind == value_kind::map) {
+			maps_[static_cast<std::size_t>(slots_[i].integer)].reserve(counts[i]);
+		} else if (kind == value_kind::list) {
+			slots_[i].integer = static_cast<std::int64_t>(total);
+			slots_[i].reserved = counts[i];
+			total += counts[i];
+		}
+	}
+	list_values_.resize(total);
+}
+
+void result::apply(const token &tok) {
+	if (tok.kind == token::type::positional) {
+		positionals_.push_back(tok.value);
+		return;
+	}
+
+	const option_def &def = spec_->def(tok.id);
+	if (tok.deprecated)
+		diagnostics_.push_back({tok.index, tok.id, deprecation(tok, def)});
+	value_slot &slot = slots_[tok.id];
+	switch (def.kind) {
+	case value_kind::flag:
+		break;
+	case value_kind::string:
+		if (slot.pending)
+			overridden_.push_back(pending_token(tok.id, slot));
+		slot.text = tok.value;
+		slot.index = tok.index;
+		slot.pending = def.pattern != nullptr;
+		break;
+	case value_kind::integer:
+	case value_kind::floating:
+	case value_kind::choice:
+		if (slot.pending)
+			overridden_.push_back(pending_token(tok.id, slot));
+		slot.text = tok.value;
+		slot.index = tok.index;
+		slot.pending = true;
+		break;
+	case value_kind::list:
+		if (slot.count == slot.reserved)
+			throw std::logic_error("option " + display_name(def) + " received more values than were reserved");
+		list_values_[static_cast<std::size_t>(slot.integer) + slot.count] = tok.value;
+		break;
+	case value_kind::map:
+		insert_pairs(tok, def, maps_[static_cast<std::size_t>(slot.integer)]);
+		break;
+	}
+	++slot.count;
+}
+
+void result::convert(option_id id) const {
+	const option_def &def = spec_->def(id);
+	value_slot &slot = slots_[id];
+	const token tok = pending_token(id, slot);
+	switch (def.kind) {
+	case value_kind::string:
+		check_pattern(tok, def);
+		break;
+	case value_kind::integer:
+		slot.integer = to_integer(tok, def);
+		break;
+	case value_kind::floating:
+		slot.floating = to_floating(tok, def);
+		break;
+	case value_kind::choice: {
+		const choice_entry &entry = to_choice(tok, def);
+		slot.text = entry.name;
+		slot.integer = entry.value;
+		break;
+	}
+	default:
+		break;
+	}
+	slot.pending = false;
+}
+
+void result::validate() const {
+	detail::first_error error;
+	for (const token &tok : overridden_)
+		error.capture([&] { check_value(tok, spec_->def(tok.id)); });
+	for (option_id id = 0; id < slots_.size(); ++id) {
+		if (slots_[id].pending)
+			error.capture([&] { convert(id); });
+	}
+	error.rethrow();
+}
+
+const value_slot &result::checked_slot(option_id id, value_kind kind) const {
+	const value_slot &slot = slots_.at(id);
+	if (spec_->def(id).kind != kind)
+		throw std::logic_error("option " + display_name(spec_->def(id)) + " read with the wrong value type");
+	if (slot.pending)
+		convert(id);
+	return slot;
+}
+
+// Tokenizes everything before applying anything, counting list values and
+// map pairs on the way so that every list lands in one exactly sized buffer
+// and no map rehashes while it fills.
+result parse(const spec &options, arg_list args, const parse_limits &limits) {
+	check_size(args, limits);
+	std::vector<token> tokens;
+	tokens.reserve(args.size());
+	std::vector<std::uint32_t> value_counts(options.size());
+	bool has_counts = false;
+
+	tokenizer split(options, args, options.requires_utf8());
+	token tok;
+	while (split.next(tok)) {
+		has_counts |= count_values(options, tok, value_counts, limits);
+		tokens.push_back(tok);
+	}
+	return apply_tokens(options, tokens, value_counts, has_counts);
+}
+
+std::vector<token> tokenize(const spec &options, arg_list args, const parse_limits &limits) {
+	check_size(args, limits);
+	std::vector<token> tokens;
+	tokens.reserve(args.size());
+	tokenizer split(options, args, options.requires_utf8());
+	token tok;
+	while (split.next(tok))
+		tokens.push_back(tok);
+	return tokens;
+}
+
+result parse_tokens(const spec &options, const std::vector<token> &tokens, const parse_limits &limits) {
+	std::vector<std::uint32_t> value_counts(options.size());
+	bool has_counts = false;
+	for (const token &tok : tokens)
+		has_counts |= count_values(options, tok, value_counts, limits);
+	return apply_tokens(options, tokens, value_counts, has_counts);
+}
+
+result parse(const spec &options, int argc, const char *const *argv, const parse_limits &limits) {
+	return parse(options, arg_list(argc, argv), limits);
+}
+
+bool pull_parser::next(parse_event &out) {
+	if (pairs_left_) {
+		const option_def &def = spec_->def(current_.id);
+		out.kind = token::type::option;
+		out.value = option_value{};
+		out.value.id = current_.id;
+		out.value.deprecated = current_.deprecated;
+		out.value.kind = def.kind;
+		out.value.index = current_.index;
+		pairs_left_ = take_pair(current_, def, pairs_, out.value.key, out.value.text);
+		return true;
+	}
+	if (!tokens_.next(current_))
+		return false;
+
+	out.kind = current_.kind;
+	option_value &value = out.value;
+	value = option_value{};
+	value.index = current_.index;
+	value.text = current_.value;
+	if (current_.kind == token::type::positional)
+		return true;
+
+	const option_def &def = spec_->def(current_.id);
+	value.id = current_.id;
+	value.deprecated = current_.deprecated;
+	value.kind = def.kind;
+	switch (def.kind) {
+	case value_kind::flag:
+	case value_kind::list:
+		break;
+	case value_kind::string:
+		check_pattern(current_, def);
+		break;
+	case value_kind::integer:
+		value.integer = to_integer(current_, def);
+		break;
+	case value_kind::floating:
+		value.floating = to_floating(current_, def);
+		break;
+	case value_kind::choice: {
+		const choice_entry &entry = to_choice(current_, def);
+		value.text = entry.name;
+		value.integer = entry.value;
+		break;
+	}
+	case value_kind::map:
+		pairs_ = current_.value;
+		pairs_left_ = take_pair(current_, def, pairs_, value.key, value.text);
+		break;
+	}
+	return true;
+}
+
+void visit(const spec &options, arg_list args, visitor &callbacks) {
+	pull_parser events(options, args);
+	parse_event event;
+	while (events.next(event)) {
+		if (event.kind == token::type::positional)
+			callbacks.on_positional(event.value.text, event.value.index);
+		else
+			callbacks.on_option(event.value);
+	}
+}
+
+} // namespace option_parser
@@ -0,0 +1,207 @@
+#include "option_parser/pattern.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+namespace option_parser {
+
+namespace {
+
+using byte_set = std::array<std::uint64_t, 4>;
+
+constexpr std::size_t unbounded = std::numeric_limits<std::size_t>::max();
+
+void add_byte(byte_set &set, unsigned char c) noexcept {
+	set[c >> 6] |= std::uint64_t{1} << (c & 63);
+}
+
+void add_range(byte_set &set, unsigned char first, unsigned char last) noexcept {
+	for (unsigned c = first; c <= last; ++c)
+		add_byte(set, static_cast<unsigned char>(c));
+}
+
+bool is_alnum(char c) noexcept {
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// Adds the bytes of \d, \w or \s; false for any other escape.
+bool add_class_escape(byte_set &set, char c) noexcept {
+	switch (c) {
+	case 'd':
+		add_range(set, '0', '9');
+		return true;
+	case 'w':
+		add_range(set, '0', '9');
+		add_range(set, 'a', 'z');
+		add_range(set, 'A', 'Z');
+		add_byte(set, '_');
+		return true;
+	case 's':
+		for (const char space : {' ', '\t', '\n', '\v', '\f', '\r'})
+			add_byte(set, static_cast<unsigned char>(space));
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Reads a decimal repeat count; nothing if there is none or it is huge.
+std::optional<std::size_t> read_count(std::string_view text, std::size_t &pos) noexcept {
+	const std::size_t start = pos;
+	std::size_t value = 0;
+	while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+		value = value * 10 + static_cast<std::size_t>(text[pos++] - '0');
+		if (value > 1000000)
+			return std::nullopt;
+	}
+	if (pos == start)
+		return std::nullopt;
+	return value;
+}
+
+// Reads a bracket expression starting after its `[`. Anything that is not
+// plain bytes, ranges and \d \w \s is left to std::regex.
+bool read_class(std::string_view text, std::size_t &pos, byte_set &set) noexcept {
+	const bool negate = pos < text.size() && text[pos] == '^';
+	if (negate)
+		++pos;
+	if (pos < text.size() && text[pos] == ']')
+		return false;
+	while (pos < text.size()) {
+		const char c = text[pos++];
+		if (c == ']') {
+			if (negate)
+				for (std::uint64_t &word : set)
+					word = ~word;
+			return true;
+		}
+		if (c == '[')
+			return false;
+		char first = c;
+		if (c == '\\') {
+			if (pos == text.size())
+				return false;
+			first = text[pos++];
+			if (add_class_escape(set, first)) {
+				if (pos + 1 < text.size() && text[pos] == '-' && text[pos + 1] != ']')
+					return false;
+				continue;
+			}
+			if (is_alnum(first))
+				return false;
+		}
+		if (pos + 1 < text.size() && text[pos] == '-' && text[pos + 1] != ']') {
+			const char last = text[pos + 1];
+			if (last == '\\' || last == '[' || static_cast<unsigned char>(last) < static_cast<unsigned char>(first))
+				return false;
+			add_range(set, static_cast<unsigned char>(first), static_cast<unsigned char>(last));
+			pos += 2;
+		} else {
+			add_byte(set, static_cast<unsigned char>(first));
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+string_pattern::string_pattern(std::string_view pattern) : source_(pattern) {
+	if (compile_simple())
+		return;
+	try {
+		regex_.emplace(source_, std::regex::ECMAScript | std::regex::optimize);
+	} catch (const std::regex_error &e) {
+		throw std::invalid_argument("invalid pattern '" + source_ + "': " + e.what());
+	}
+}
+
+bool string_pattern::matches(std::string_view text) const {
+	if (regex_)
+		return std::regex_match(text.begin(), text.end(), *regex_);
+	if (text.size() < min_length_ || text.size() > max_length_)
+		return false;
+	for (const char c : text) {
+		const auto byte = static_cast<unsigned char>(c);
+		if ((bytes_[byte >> 6] >> (byte & 63) & 1) == 0)
+			return false;
+	}
+	return true;
+}
+
+// One atom (a bracket expression, \d, \w, \s or `.`), an optional greedy
+// quantifier, and optional ^ and $ anchors, which whole value matching
+// makes redundant.
+bool string_pattern::compile_simple() {
+	std::string_view text = source_;
+	if (!text.empty() && text.front() == '^')
+		text.remove_prefix(1);
+	if (!text.empty() && text.back() == '$') {
+		if (text.size() > 1 && text[text.size() - 2] == '\\')
+			return false;
+		text.remove_suffix(1);
+	}
+	if (text.empty())
+		return false;
+
+	byte_set set{};
+	std::size_t pos = 1;
+	if (text[0] == '[') {
+		if (!read_class(text, pos, set))
+			return false;
+	} else if (text[0] == '\\' && text.size() > 1 && add_class_escape(set, text[1])) {
+		pos = 2;
+	} else if (text[0] == '.') {
+		set.fill(~std::uint64_t{0});
+		set['\n' >> 6] &= ~(std::uint64_t{1} << ('\n' & 63));
+		set['\r' >> 6] &= ~(std::uint64_t{1} << ('\r' & 63));
+	} else {
+		return false;
+	}
+
+	std::size_t min = 1;
+	std::size_t max = 1;
+	if (pos < text.size()) {
+		switch (text[pos++]) {
+		case '*':
+			min = 0;
+			max = unbounded;
+			break;
+		case '+':
+			max = unbounded;
+			break;
+		case '?':
+			min = 0;
+			break;
+		case '{': {
+			const std::optional<std::size_t> low = read_count(text, pos);
+			if (!low || pos == text.size())
+				return false;
+			min = max = *low;
+			if (text[pos] == ',') {
+				++pos;
+				max = unbounded;
+				if (pos < text.size() && text[pos] != '}') {
+					const std::optional<std::size_t> high = read_count(text, pos);
+					if (!high || *high < min)
+						return false;
+					max = *high;
+				}
+			}
+			if (pos == text.size() || text[pos++] != '}')
+				return false;
+			break;
+		}
+		default:
+			return false;
+		}
+	}
+	if (pos != text.size())
+		return false;
+
+	bytes_ = set;
+	min_length_ = min;
+	max_length_ = max;
+	return true;
+}
+
+} // namespace option_parser
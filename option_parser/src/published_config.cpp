@@ -0,0 +1,71 @@
+#include "option_parser/published_config.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace option_parser {
+
+published_config::published_config(std::shared_ptr<const config> initial, std::size_t max_readers)
+    : slots_(new slot[max_readers]), slot_count_(max_readers), current_(initial.get()), owner_(std::move(initial)) {
+	if (!owner_)
+		throw std::invalid_argument("published_config needs an initial config");
+}
+
+published_config::~published_config() = default;
+
+published_config::reader::reader(published_config &published) : published_(&published) {
+	for (slot_ = 0; slot_ < published.slot_count_; ++slot_) {
+		bool expected = false;
+		if (published.slots_[slot_].claimed.compare_exchange_strong(expected, true, std::memory_order_acquire))
+			return;
+	}
+	throw std::length_error("published_config has no free reader slot");
+}
+
+published_config::reader::~reader() {
+	published_->slots_[slot_].claimed.store(false, std::memory_order_release);
+}
+
+// The new pointer is stored before the epoch advances, both sequentially
+// consistent, and a reader announces before it loads. A reader announcing
+// an epoch after the one a config was retired in therefore loads a newer
+// pointer; one announcing it or an earlier one blocks the release. A reader
+// whose announcement lands after the scan loads after the store as well.
+void published_config::install(std::shared_ptr<const config> next) {
+	if (!next)
+		throw std::invalid_argument("published_config cannot install a null config");
+	const std::lock_guard<std::mutex> lock(writers_);
+	current_.store(next.get(), std::memory_order_seq_cst);
+	const std::uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+	retired_.push_back({epoch, std::exchange(owner_, std::move(next))});
+	reclaim_locked();
+}
+
+std::shared_ptr<const config> published_config::current() const {
+	const std::lock_guard<std::mutex> lock(writers_);
+	return owner_;
+}
+
+std::size_t published_config::reclaim() {
+	const std::lock_guard<std::mutex> lock(writers_);
+	return reclaim_locked();
+}
+
+std::size_t published_config::reclaim_locked() {
+	if (retired_.empty())
+		return 0;
+	std::uint64_t oldest = epoch_.load(std::memory_order_seq_cst);
+	for (std::size_t i = 0; i < slot_count_; ++i) {
+		const std::uint64_t announced = slots_[i].epoch.load(std::memory_order_seq_cst);
+		if (announced != quiescent)
+			oldest = std::min(oldest, announced);
+	}
+	// retired_ is in epoch order; everything retired before the oldest
+	// announced epoch is out of reach.
+	const auto reachable = std::find_if(retired_.begin(), retired_.end(),
+	                                    [&](const retired &entry) { return entry.epoch >= oldest; });
+	retired_.erase(retired_.begin(), reachable);
+	return retired_.size();
+}
+
+} // namespace option_parser
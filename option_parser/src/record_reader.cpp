@@ -0,0 +1,71 @@
+#include "option_parser/record_reader.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace option_parser {
+
+record_reader::record_reader(int fd, char delimiter, std::size_t buffer_size, std::size_t max_record)
+    : fd_(fd), delimiter_(delimiter), max_record_(max_record), buffer_(buffer_size == 0 ? 1 : buffer_size) {}
+
+bool record_reader::next(std::string_view &record) {
+	for (;;) {
+		const char *data = buffer_.data();
+		const void *found = std::memchr(data + begin_ + scanned_, delimiter_, end_ - begin_ - scanned_);
+		if (found != nullptr) {
+			const std::size_t stop = static_cast<std::size_t>(static_cast<const char *>(found) - data);
+			record = std::string_view(data + begin_, stop - begin_);
+			begin_ = stop + 1;
+			scanned_ = 0;
+			return true;
+		}
+		scanned_ = end_ - begin_;
+		if (scanned_ > max_record_)
+			throw std::length_error("record exceeds the maximum record size");
+
+		if (eof_ || !fill()) {
+			if (begin_ == end_)
+				return false;
+			record = std::string_view(buffer_.data() + begin_, end_ - begin_);
+			begin_ = end_;
+			scanned_ = 0;
+			return true;
+		}
+	}
+}
+
+// Reads more input behind the unconsumed bytes, first moving them to the
+// front of the buffer and, if they already fill it, growing the buffer.
+// Returns false at end of stream.
+bool record_reader::fill() {
+	if (begin_ != 0) {
+		std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+		end_ -= begin_;
+		begin_ = 0;
+	}
+	if (end_ == buffer_.size()) {
+		if (buffer_.size() > max_record_)
+			throw std::length_error("record exceeds the maximum record size");
+		buffer_.resize(buffer_.size() * 2 < max_record_ + 1 ? buffer_.size() * 2 : max_record_ + 1);
+	}
+
+	for (;;) {
+		const ssize_t got = ::read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+		if (got > 0) {
+			end_ += static_cast<std::size_t>(got);
+			return true;
+		}
+		if (got == 0) {
+			eof_ = true;
+			return false;
+		}
+		if (errno != EINTR)
+			throw std::system_error(errno, std::generic_category(), "reading records");
+	}
+}
+
+} // namespace option_parser
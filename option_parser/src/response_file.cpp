@@ -0,0 +1,97 @@
+#include "option_parser/response_file.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace option_parser {
+
+namespace {
+
+bool is_response_file(std::string_view arg) noexcept {
+	return arg.size() > 1 && arg[0] == '@';
+}
+
+struct expander {
+	const file_loader &load;
+	const parse_limits &limits;
+	std::vector<std::string_view> &out;
+	std::vector<std::unique_ptr<std::string>> &contents;
+	std::vector<command_line> &words;
+	std::size_t file_bytes = 0;
+	std::size_t arg_bytes = 0;
+
+	// Appends one expanded argument taken from the top-level argument index.
+	void emit(std::string_view arg, std::size_t index) {
+		if (out.size() == limits.max_args)
+			throw limit_error(limit_kind::args, limits.max_args, index,
+			                  "more than " + std::to_string(limits.max_args) + " arguments");
+		arg_bytes += arg.size();
+		if (arg_bytes > limits.max_bytes)
+			throw limit_error(limit_kind::bytes, limits.max_bytes, index,
+			                  "arguments exceed " + std::to_string(limits.max_bytes) + " bytes");
+		out.push_back(arg);
+	}
+
+	// Expands one @path found depth levels below the top-level argument index.
+	void expand(std::string_view arg, std::size_t index, std::size_t depth) {
+		const std::string_view path = arg.substr(1);
+		if (depth >= limits.max_response_depth)
+			throw limit_error(limit_kind::response_depth, limits.max_response_depth, index,
+			                  "response file " + std::string(path) + " is nested too deeply");
+		const std::size_t budget = limits.max_response_bytes - file_bytes;
+		std::optional<std::string> text = load(path, budget);
+		if (!text)
+			throw parse_error(error_code::response_file, index, "cannot read response file " + std::string(path));
+		if (text->size() > budget)
+			throw limit_error(limit_kind::response_bytes, limits.max_response_bytes, index,
+			                  "response files exceed " + std::to_string(limits.max_response_bytes) + " bytes");
+		file_bytes += text->size();
+
+		contents.push_back(std::make_unique<std::string>(std::move(*text)));
+		words.push_back(split_command(*contents.back()));
+		for (const std::string_view word : words.back().args()) {
+			if (is_response_file(word))
+				expand(word, index, depth + 1);
+			else
+				emit(word, index);
+		}
+	}
+};
+
+} // namespace
+
+std::optional<std::string> read_file(std::string_view path, std::size_t max_size) {
+	std::ifstream in(std::string(path), std::ios::binary);
+	if (!in)
+		return std::nullopt;
+	// Reads in chunks up to one byte past max_size, so an oversized file
+	// costs no more memory than the limit.
+	const std::size_t cap = max_size == parse_limits::unlimited ? max_size : max_size + 1;
+	std::string text;
+	char chunk[4096];
+	while (text.size() < cap) {
+		in.read(chunk, static_cast<std::streamsize>(std::min(sizeof chunk, cap - text.size())));
+		text.append(chunk, static_cast<std::size_t>(in.gcount()));
+		if (!in)
+			break;
+	}
+	if (in.bad())
+		return std::nullopt;
+	return text;
+}
+
+expanded_args expand_response_files(arg_list args, const file_loader &load, const parse_limits &limits) {
+	expanded_args result;
+	result.args_.reserve(std::min(args.size(), limits.max_args));
+	expander state{load, limits, result.args_, result.contents_, result.words_};
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		const std::string_view arg = args[i];
+		if (is_response_file(arg))
+			state.expand(arg, i, 0);
+		else
+			state.emit(arg, i);
+	}
+	return result;
+}
+
+} // namespace option_parser
@@ -0,0 +1,247 @@
+#include "option_parser/snapshot.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace option_parser {
+
+namespace {
+
+constexpr char magic[4] = {'O', 'P', 'S', 'N'};
+constexpr std::uint16_t byte_order_mark = 0x0102;
+constexpr std::uint64_t header_size = 32;
+constexpr std::uint64_t option_size = 40;
+constexpr std::uint64_t string_ref_size = 8;
+
+template <typename T>
+void put(std::string &out, T value) {
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, &value, sizeof bytes);
+	out.append(bytes, sizeof bytes);
+}
+
+// Appends text to the pool and writes its reference to out.
+void put_string(std::string &out, std::string &pool, std::string_view text) {
+	if (pool.size() + text.size() > std::numeric_limits<std::uint32_t>::max())
+		throw std::length_error("snapshot strings exceed 4 GiB");
+	put(out, static_cast<std::uint32_t>(pool.size()));
+	put(out, static_cast<std::uint32_t>(text.size()));
+	pool.append(text);
+}
+
+[[noreturn]] void malformed(const std::string &why) {
+	throw std::invalid_argument("malformed snapshot: " + why);
+}
+
+// Bounds are checked once against the total size, so reads need not be.
+struct reader {
+	const char *data;
+
+	template <typename T>
+	T get() noexcept {
+		T value;
+		std::memcpy(&value, data, sizeof value);
+		data += sizeof value;
+		return value;
+	}
+};
+
+std::string_view get_string(reader &in, std::string_view pool) {
+	const std::uint64_t offset = in.get<std::uint32_t>();
+	const std::uint64_t size = in.get<std::uint32_t>();
+	if (offset + size > pool.size())
+		malformed("string outside the pool");
+	return pool.substr(offset, size);
+}
+
+// One run of string references.
+struct string_table {
+	const char *refs;
+	std::string_view pool;
+
+	std::string_view at(std::uint64_t i) const {
+		reader in{refs + i * string_ref_size};
+		return get_string(in, pool);
+	}
+};
+
+} // namespace
+
+std::string save_snapshot(const result &parsed) {
+	parsed.validate();
+	const spec &options = *parsed.spec_;
+	std::uint64_t map_entries = 0;
+	for (const flat_string_map &map : parsed.maps_)
+		map_entries += map.size();
+
+	std::string out;
+	std::string pool;
+	out.append(magic, sizeof magic);
+	put(out, snapshot_version);
+	put(out, byte_order_mark);
+	put(out, static_cast<std::uint32_t>(parsed.slots_.size()));
+	put(out, static_cast<std::uint32_t>(parsed.positionals_.size()));
+	put(out, static_cast<std::uint32_t>(parsed.list_values_.size()));
+	put(out, static_cast<std::uint32_t>(map_entries));
+	const std::size_t pool_size_at = out.size();
+	put(out, std::uint32_t{0});
+	put(out, std::uint32_t{0});
+
+	std::uint64_t first_entry = 0;
+	for (std::size_t i = 0; i < parsed.slots_.size(); ++i) {
+		const value_slot &slot = parsed.slots_[i];
+		const value_kind kind = options.def(static_cast<option_id>(i)).kind;
+		std::uint32_t extent = 0;
+		std::int64_t integer = slot.integer;
+		if (kind == value_kind::list) {
+			extent = slot.reserved;
+		} else if (kind == value_kind::map) {
+			extent = static_cast<std::uint32_t>(parsed.maps_[static_cast<std::size_t>(slot.integer)].size());
+			integer = static_cast<std::int64_t>(first_entry);
+			first_entry += extent;
+		}
+		put(out, static_cast<std::uint32_t>(kind));
+		put(out, slot.count);
+		put(out, extent);
+		put_string(out, pool, slot.text);
+		put(out, std::uint32_t{0});
+		put(out, integer);
+		put(out, slot.floating);
+	}
+	for (const std::string_view positional : parsed.positionals_)
+		put_string(out, pool, positional);
+	for (const std::string_view value : parsed.list_values_)
+		put_string(out, pool, value);
+	for (const flat_string_map &map : parsed.maps_) {
+		for (const flat_string_map::entry &entry : map) {
+			put_string(out, pool, entry.key);
+			put_string(out, pool, entry.value);
+		}
+	}
+
+	const auto pool_size = static_cast<std::uint32_t>(pool.size());
+	std::memcpy(&out[pool_size_at], &pool_size, sizeof pool_size);
+	out += pool;
+	return out;
+}
+
+result restore_snapshot(const spec &options, std::string_view bytes) {
+	if (bytes.size() < header_size || std::memcmp(bytes.data(), magic, sizeof magic) != 0)
+		malformed("missing header");
+	reader in{bytes.data() + sizeof magic};
+	const auto version = in.get<std::uint16_t>();
+	if (in.get<std::uint16_t>() != byte_order_mark)
+		malformed("written with the other byte order");
+	if (version == 0 || version > snapshot_version)
+		throw std::invalid_argument("unsupported snapshot version " + std::to_string(version));
+	const auto option_count = in.get<std::uint32_t>();
+	const auto positional_count = in.get<std::uint32_t>();
+	const auto list_count = in.get<std::uint32_t>();
+	const auto entry_count = in.get<std::uint32_t>();
+	const auto pool_size = in.get<std::uint32_t>();
+	in.get<std::uint32_t>();
+
+	const std::uint64_t refs_at = header_size + option_count * option_size;
+	const std::uint64_t pool_at =
+	    refs_at + (std::uint64_t{positional_count} + list_count + 2 * std::uint64_t{entry_count}) * string_ref_size;
+	if (pool_at + pool_size != bytes.size())
+		malformed("size does not match its header");
+	if (option_count > options.size())
+		throw std::invalid_argument("snapshot has more options than the spec");
+
+	const std::string_view pool = bytes.substr(pool_at);
+	const string_table positionals{bytes.data() + refs_at, pool};
+	const string_table list_values{positionals.refs + positional_count * string_ref_size, pool};
+	const string_table entries{list_values.refs + list_count * string_ref_size, pool};
+
+	result restored(options);
+	restored.positionals_.reserve(positional_count);
+	for (std::uint32_t i = 0; i < positional_count; ++i)
+		restored.positionals_.push_back(positionals.at(i));
+	restored.list_values_.reserve(list_count);
+	for (std::uint32_t i = 0; i < list_count; ++i)
+		restored.list_values_.push_back(list_values.at(i));
+
+	in.data = bytes.data() + header_size;
+	for (option_id id = 0; id < option_count; ++id) {
+		const option_def &def = options.def(id);
+		if (in.get<std::uint32_t>() != static_cast<std::uint32_t>(def.kind))
+			throw std::invalid_argument("snapshot does not match the spec at option " + def.long_name);
+		value_slot &slot = restored.slots_[id];
+		slot.count = in.get<std::uint32_t>();
+		const std::uint64_t extent = in.get<std::uint32_t>();
+		slot.text = get_string(in, pool);
+		in.get<std::uint32_t>();
+		const auto integer = in.get<std::int64_t>();
+		slot.floating = in.get<double>();
+
+		if (def.kind == value_kind::list) {
+			if (integer < 0 || static_cast<std::uint64_t>(integer) + extent > list_count || slot.count > extent)
+				malformed("list values out of range");
+			slot.integer = integer;
+			slot.reserved = static_cast<std::uint32_t>(extent);
+		} else if (def.kind == value_kind::map) {
+			if (integer < 0 || static_cast<std::uint64_t>(integer) + extent > entry_count)
+				malformed("map entries out of range");
+			flat_string_map &map = restored.maps_[static_cast<std::size_t>(slot.integer)];
+			map.reserve(extent);
+			for (std::uint64_t e = static_cast<std::uint64_t>(integer); e < static_cast<std::uint64_t>(integer) + extent; ++e)
+				map.insert(entries.at(2 * e), entries.at(2 * e + 1));
+		} else {
+			slot.integer = integer;
+		}
+	}
+	return restored;
+}
+
+mapped_file::mapped_file(const std::string &path) {
+	const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+	struct stat info;
+	if (::fstat(fd, &info) != 0) {
+		const int error = errno;
+		::close(fd);
+		throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+	}
+	size_ = static_cast<std::size_t>(info.st_size);
+	if (size_ != 0) {
+		data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data_ == MAP_FAILED) {
+			const int error = errno;
+			::close(fd);
+			data_ = nullptr;
+			throw std::system_error(error, std::generic_category(), "cannot map " + path);
+		}
+	}
+	::close(fd);
+}
+
+mapped_file::~mapped_file() {
+	if (data_ != nullptr)
+		::munmap(data_, size_);
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept {
+	if (this != &other) {
+		if (data_ != nullptr)
+			::munmap(data_, size_);
+		data_ = std::exchange(other.data_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+	}
+	return *this;
+}
+
+} // namespace option_parser
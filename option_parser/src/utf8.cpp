@@ -0,0 +1,74 @@
+#include "option_parser/utf8.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace option_parser {
+
+namespace {
+
+constexpr std::uint64_t high_bits = 0x8080808080808080;
+
+// What a byte allows when it leads a sequence: the sequence length (0 for
+// bytes that cannot lead one) and the range of the second byte, narrower
+// after the leads that would otherwise allow overlongs, surrogates or code
+// points past U+10FFFF.
+struct lead_rule {
+	std::uint8_t length = 0;
+	std::uint8_t low = 0x80;
+	std::uint8_t high = 0xbf;
+};
+
+constexpr std::array<lead_rule, 256> make_lead_rules() {
+	std::array<lead_rule, 256> rules{};
+	for (unsigned c = 0; c < 0x80; ++c)
+		rules[c].length = 1;
+	for (unsigned c = 0xc2; c <= 0xdf; ++c)
+		rules[c].length = 2;
+	for (unsigned c = 0xe0; c <= 0xef; ++c)
+		rules[c].length = 3;
+	for (unsigned c = 0xf0; c <= 0xf4; ++c)
+		rules[c].length = 4;
+	rules[0xe0].low = 0xa0;
+	rules[0xed].high = 0x9f;
+	rules[0xf0].low = 0x90;
+	rules[0xf4].high = 0x8f;
+	return rules;
+}
+
+constexpr std::array<lead_rule, 256> lead_rules = make_lead_rules();
+
+} // namespace
+
+std::size_t find_invalid_utf8(std::string_view text) noexcept {
+	const auto *bytes = reinterpret_cast<const unsigned char *>(text.data());
+	const std::size_t size = text.size();
+	std::size_t i = 0;
+	while (i < size) {
+		for (std::uint64_t word; i + sizeof word <= size; i += sizeof word) {
+			std::memcpy(&word, bytes + i, sizeof word);
+			if ((word & high_bits) != 0)
+				break;
+		}
+		// Decode up to the end of the word that had a high bit, or the tail,
+		// before trying whole words again.
+		const std::size_t window = size - i > sizeof(std::uint64_t) ? i + sizeof(std::uint64_t) : size;
+		while (i < window) {
+			const lead_rule rule = lead_rules[bytes[i]];
+			if (rule.length == 1) {
+				++i;
+				continue;
+			}
+			if (rule.length == 0 || size - i < rule.length || bytes[i + 1] < rule.low || bytes[i + 1] > rule.high)
+				return i;
+			for (std::size_t k = 2; k < rule.length; ++k)
+				if ((bytes[i + k] & 0xc0) != 0x80)
+					return i;
+			i += rule.length;
+		}
+	}
+	return std::string_view::npos;
+}
+
+} // namespace option_parser
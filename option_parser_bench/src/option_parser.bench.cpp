@@ -0,0 +1,356 @@
+#include "fuzz_input.hpp"
+#include "option_parser/command_line.hpp"
+#include "option_parser/option_parser.hpp"
+#include "option_parser/pattern.hpp"
+#include "option_parser/published_config.hpp"
+#include "option_parser/snapshot.hpp"
+#include "option_parser/utf8.hpp"
+#include "server_options.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// Runs fn repeatedly for roughly a fixed wall time and prints the average
+// cost per item; fn returns a value that is folded into a sink so the work
+// cannot be optimized away.
+template <typename Fn>
+void measure(const char *name, std::size_t items, Fn &&fn) {
+	using clock = std::chrono::steady_clock;
+	std::size_t sink = 0;
+	std::size_t iterations = 0;
+	const auto start = clock::now();
+	auto elapsed = clock::duration::zero();
+	do {
+		sink += fn();
+		++iterations;
+		elapsed = clock::now() - start;
+	} while (elapsed < std::chrono::milliseconds(500));
+
+	const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+	std::printf("%-32s %10zu iterations %10.2f ns/item (%zu)\n", name, iterations, ns / double(iterations * items),
+	            sink % 10);
+}
+
+void bench_many_repeats() {
+	spec options;
+	const option_id include = options.add_list("include", 'I');
+	options.add_flag("verbose", 'v');
+
+	std::vector<std::string> storage;
+	for (int i = 0; i < 20000; ++i)
+		storage.push_back("-I/usr/include/project/module" + std::to_string(i));
+	storage.push_back("-v");
+	const std::vector<std::string_view> args(storage.begin(), storage.end());
+
+	measure("list/20k -I flags", args.size(), [&] { return parse(options, arg_list(args)).get<string_span>(include).size(); });
+}
+
+// Archive style clusters over a spec with many short options, so lookups
+// dominate.
+void bench_short_clusters() {
+	spec options;
+	std::vector<option_id> flags;
+	for (char c = 'a'; c <= 'z'; ++c) {
+		flags.push_back(options.add_flag(std::string("lower-") + c, c));
+		options.add_flag(std::string("upper-") + c, static_cast<char>(c - 'a' + 'A'));
+	}
+	const std::vector<std::string_view> args(1000, "-xvzfpqrstuWXYZ");
+
+	measure("short/clustered letters", args.size() * 14, [&] { return parse(options, arg_list(args)).count(flags[0]); });
+}
+
+// Per-byte decoder without the ASCII word skip, for comparison.
+bool decode_utf8(std::string_view text) {
+	std::size_t need = 0;
+	for (const char c : text) {
+		const auto byte = static_cast<unsigned char>(c);
+		if (need > 0) {
+			if ((byte & 0xc0) != 0x80)
+				return false;
+			--need;
+		} else if (byte >= 0x80) {
+			need = byte >= 0xf0 ? 3 : byte >= 0xe0 ? 2 : 1;
+		}
+	}
+	return need == 0;
+}
+
+void bench_utf8() {
+	std::string ascii;
+	std::string mixed;
+	for (int i = 0; i < 1000; ++i) {
+		ascii += "/home/build/project/src/module" + std::to_string(i) + "/file.cpp";
+		mixed += "/srv/données/日本語/étiquette-" + std::to_string(i) + "/файл.txt";
+	}
+	measure("utf8/ascii paths", ascii.size(), [&] { return std::size_t{is_valid_utf8(ascii)}; });
+	measure("utf8/ascii paths, per byte", ascii.size(), [&] { return std::size_t{decode_utf8(ascii)}; });
+	measure("utf8/mixed labels", mixed.size(), [&] { return std::size_t{is_valid_utf8(mixed)}; });
+	measure("utf8/mixed labels, per byte", mixed.size(), [&] { return std::size_t{decode_utf8(mixed)}; });
+}
+
+// A host loading 30 plugins of 40 options each: merged as they arrive,
+// against rebuilding the whole spec after each one.
+void bench_plugins() {
+	std::vector<spec> plugins;
+	for (int p = 0; p < 30; ++p) {
+		spec &plugin = plugins.emplace_back();
+		for (int i = 0; i < 40; ++i)
+			plugin.add_int("plugin" + std::to_string(p) + ".knob" + std::to_string(i));
+	}
+	measure("plugins/merge 30x40", 30 * 40, [&] {
+		spec host;
+		host.add_flag("verbose", 'v');
+		for (const spec &plugin : plugins)
+			host.merge(plugin);
+		return host.size();
+	});
+	measure("plugins/rebuild 30x40", 30 * 40, [&] {
+		std::size_t size = 0;
+		for (std::size_t loaded = 1; loaded <= plugins.size(); ++loaded) {
+			spec host;
+			host.add_flag("verbose", 'v');
+			for (std::size_t p = 0; p < loaded; ++p)
+				for (int i = 0; i < 40; ++i)
+					host.add_int("plugin" + std::to_string(p) + ".knob" + std::to_string(i));
+			size = host.size();
+		}
+		return size;
+	});
+}
+
+void bench_split_command() {
+	std::string plain;
+	std::string quoted;
+	for (int i = 0; i < 200; ++i) {
+		plain += " --input /data/shard-" + std::to_string(i) + " -v";
+		quoted += " --label 'team=infra ops' --name=\"job \\\"" + std::to_string(i) + "\\\"\" a\\ b";
+	}
+	measure("split/plain words", plain.size(), [&] { return split_command(plain).size(); });
+	measure("split/quoted and escaped", quoted.size(), [&] { return split_command(quoted).size(); });
+}
+
+// Hundreds of numeric options set, a handful read: conversion is paid
+// only for what is read.
+void bench_lazy_conversion() {
+	spec options;
+	std::vector<std::string> storage;
+	for (int i = 0; i < 300; ++i) {
+		options.add_double("ratio-" + std::to_string(i));
+		storage.push_back("--ratio-" + std::to_string(i) + "=0.12345678901234" + std::to_string(i));
+	}
+	const std::vector<std::string_view> args(storage.begin(), storage.end());
+
+	measure("lazy/300 set, 3 read", args.size(), [&] {
+		const result parsed = parse(options, arg_list(args));
+		return static_cast<std::size_t>(parsed.get<double>(0) + parsed.get<double>(100) + parsed.get<double>(200));
+	});
+	measure("lazy/300 set, validated", args.size(), [&] {
+		const result parsed = parse(options, arg_list(args));
+		parsed.validate();
+		return static_cast<std::size_t>(parsed.get<double>(0));
+	});
+}
+
+// Validating host names: the compiled byte set path, the std::regex
+// fallback, and building a std::regex on every parse.
+void bench_patterns() {
+	std::vector<std::string> hosts;
+	for (int i = 0; i < 1000; ++i)
+		hosts.push_back("web-" + std::to_string(i) + "-eu-west");
+	const auto count = [&](auto &&matches) {
+		std::size_t good = 0;
+		for (const std::string &host : hosts)
+			good += matches(host);
+		return good;
+	};
+
+	const string_pattern simple("[a-z0-9-]{1,63}");
+	const string_pattern regex("[a-z0-9]+(-[a-z0-9]+)*");
+	measure("pattern/byte set", hosts.size(), [&] { return count([&](const std::string &h) { return simple.matches(h); }); });
+	measure("pattern/regex compiled once", hosts.size(),
+	        [&] { return count([&](const std::string &h) { return regex.matches(h); }); });
+	measure("pattern/regex per value", hosts.size(), [&] {
+		return count([](const std::string &h) { return std::regex_match(h, std::regex("[a-z0-9-]{1,63}")); });
+	});
+
+	spec options;
+	const option_id host = options.add_pattern("host", 'H', "[a-z0-9-]{1,63}");
+	std::vector<std::string_view> args;
+	for (const std::string &h : hosts) {
+		args.push_back("-H");
+		args.push_back(h);
+	}
+	measure("pattern/parse and validate", hosts.size(), [&] {
+		const result parsed = parse(options, arg_list(args));
+		parsed.validate();
+		return parsed.get<std::string_view>(host).size();
+	});
+}
+
+// A long argument list parsed from scratch against restoring its snapshot.
+void bench_snapshot() {
+	spec options;
+	options.add_list("include", 'I');
+	options.add_map("define", 'D');
+	options.add_int("jobs", 'j');
+
+	std::vector<std::string> storage;
+	for (int i = 0; i < 5000; ++i) {
+		storage.push_back("-I/usr/include/project/module" + std::to_string(i));
+		storage.push_back("-DFEATURE_" + std::to_string(i) + "=1");
+		storage.push_back("--jobs=" + std::to_string(i));
+	}
+	const std::vector<std::string_view> args(storage.begin(), storage.end());
+	const std::string bytes = save_snapshot(parse(options, arg_list(args)));
+
+	measure("snapshot/parse 15k args", args.size(), [&] { return parse(options, arg_list(args)).positionals().size() + 1; });
+	measure("snapshot/restore 15k args", args.size(), [&] { return restore_snapshot(options, bytes).count(2); });
+}
+
+// Every seed of the fuzz corpus through the full fuzz pipeline.
+// A typical command line parsed by the generated parser against the runtime
+// one built from the same spec file, both converting every value.
+void bench_generated() {
+	const spec options = demo::server_options_spec();
+	const std::vector<std::string_view> args{"-v", "--jobs=8", "-p", "9090", "--ratio=0.75", "--name=api",
+	                                         "-Hweb-1", "--level=high", "--format=json", "-I", "inc", "-la=1,b=2",
+	                                         "--journal", "input.txt"};
+	measure("generated/runtime spec", args.size(), [&] {
+		const result parsed = parse(options, arg_list(args));
+		parsed.validate();
+		return static_cast<std::size_t>(parsed.get<std::int64_t>("jobs"));
+	});
+	measure("generated/compiled switches", args.size(),
+	        [&] { return static_cast<std::size_t>(demo::parse_server_options(arg_list(args)).jobs); });
+}
+
+// Reading one int option in an inner loop from a validated result, by long
+// name, by id and through a typed handle.
+void bench_handles() {
+	spec options;
+	for (int i = 0; i < 40; ++i)
+		options.add_flag("flag-" + std::to_string(i));
+	const option_handle<std::int64_t> batch = options.add_int("batch-size", 'b', 64);
+	const std::vector<std::string_view> args{"--batch-size=256"};
+	const result parsed = parse(options, arg_list(args));
+	parsed.validate();
+	constexpr std::size_t reads = 1000;
+
+	measure("handles/by name", reads, [&] {
+		std::size_t sum = 0;
+		for (std::size_t i = 0; i < reads; ++i)
+			sum += static_cast<std::size_t>(parsed.get<std::int64_t>("batch-size"));
+		return sum;
+	});
+	measure("handles/by id", reads, [&] {
+		std::size_t sum = 0;
+		for (std::size_t i = 0; i < reads; ++i)
+			sum += static_cast<std::size_t>(parsed.get<std::int64_t>(batch.id()));
+		return sum;
+	});
+	measure("handles/typed handle", reads, [&] {
+		std::size_t sum = 0;
+		for (std::size_t i = 0; i < reads; ++i)
+			sum += static_cast<std::size_t>(parsed.get(batch));
+		return sum;
+	});
+}
+
+// Reads of one runtime flag from the current config by four threads at
+// once, the way request handlers read it, behind a mutex, through an
+// atomic shared_ptr and through published_config.
+void bench_published_config() {
+	spec options;
+	const option_id batch = options.add_int("batch-size", 'b', 64);
+	options.seal();
+	const std::shared_ptr<const config> initial = config::make(options, {"--batch-size=128"});
+	constexpr unsigned threads = 4;
+	constexpr std::size_t reads = 100000;
+
+	// make_reader runs on each thread and returns what reads the flag there.
+	const auto on_threads = [&](auto &&make_reader) {
+		std::vector<std::thread> workers;
+		std::vector<std::size_t> sums(threads);
+		for (unsigned t = 0; t < threads; ++t)
+			workers.emplace_back([&, t] {
+				auto read_one = make_reader();
+				std::size_t sum = 0;
+				for (std::size_t i = 0; i < reads; ++i)
+					sum += read_one();
+				sums[t] = sum;
+			});
+		for (std::thread &worker : workers)
+			worker.join();
+		return sums[0];
+	};
+
+	std::mutex lock;
+	std::shared_ptr<const config> locked = initial;
+	measure("published/mutex, 4 threads", threads * reads, [&] {
+		return on_threads([&] {
+			return [&] {
+				const std::lock_guard<std::mutex> guard(lock);
+				return static_cast<std::size_t>(locked->values().get<std::int64_t>(batch));
+			};
+		});
+	});
+	measure("published/atomic shared_ptr", threads * reads, [&] {
+		return on_threads([&] {
+			return [&] { return static_cast<std::size_t>(std::atomic_load(&locked)->values().get<std::int64_t>(batch)); };
+		});
+	});
+	published_config published(initial);
+	measure("published/epoch reader", threads * reads, [&] {
+		return on_threads([&] {
+			return [&, reader = std::make_shared<published_config::reader>(published)] {
+				return static_cast<std::size_t>(reader->read()->values().get<std::int64_t>(batch));
+			};
+		});
+	});
+}
+
+void bench_fuzz_corpus() {
+	std::vector<std::string> inputs;
+	std::size_t bytes = 0;
+	for (const auto &entry : std::filesystem::directory_iterator(OPTION_PARSER_CORPUS_DIR)) {
+		std::ifstream in(entry.path(), std::ios::binary);
+		inputs.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		bytes += inputs.back().size();
+	}
+	measure("fuzz corpus/bytes", bytes, [&] {
+		for (const std::string &input : inputs)
+			fuzz::run_input(reinterpret_cast<const std::uint8_t *>(input.data()), input.size());
+		return inputs.size();
+	});
+}
+
+} // namespace
+
+int main() {
+	bench_many_repeats();
+	bench_short_clusters();
+	bench_utf8();
+	bench_plugins();
+	bench_split_command();
+	bench_snapshot();
+	bench_lazy_conversion();
+	bench_handles();
+	bench_patterns();
+	bench_generated();
+	bench_published_config();
+	bench_fuzz_corpus();
+	return 0;
+}
@@ -0,0 +1,124 @@
+#include "fuzz_input.hpp"
+
+#include "option_parser/command_line.hpp"
+#include "option_parser/option_parser.hpp"
+#include "option_parser/response_file.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace option_parser::fuzz {
+
+namespace {
+
+enum class level { low, medium, high, critical };
+
+constexpr auto levels = make_choices<level>(
+    {{"low", level::low}, {"medium", level::medium}, {"high", level::high}, {"Critical", level::critical}});
+
+// One option of every kind, with short names so clusters get exercised.
+const spec &fuzz_spec() {
+	static const spec options = [] {
+		spec s;
+		s.add_flag("verbose", 'v');
+		s.add_flag("quiet", 'q');
+		s.add_int("jobs", 'j');
+		s.add_double("ratio", 'r');
+		s.add_string("name", 'n');
+		s.add_choice("level", 'l', levels, level::low, choice_match::prefix);
+		s.add_choice("Level", 'L', levels, level::low, choice_match::ignore_case);
+		s.add_list("include", 'I');
+		s.add_map("label", 'm', ',', duplicate_key::reject);
+		s.add_map("define", 'D');
+		s.add_pattern("host", 'H', "[a-z0-9.-]{1,63}");
+		s.seal();
+		return s;
+	}();
+	return options;
+}
+
+// Reads every value back so the accessors run too.
+std::size_t consume(const spec &options, const result &parsed) {
+	std::size_t sink = parsed.positionals().size();
+	for (option_id id = 0; id < options.size(); ++id) {
+		switch (options.def(id).kind) {
+		case value_kind::flag:
+			sink += parsed.get<bool>(id);
+			break;
+		case value_kind::string:
+			sink += parsed.get<std::string_view>(id).size();
+			break;
+		case value_kind::integer:
+			sink += static_cast<std::size_t>(parsed.get<std::int64_t>(id));
+			break;
+		case value_kind::floating:
+			sink += parsed.get<double>(id) > 0;
+			break;
+		case value_kind::choice:
+			sink += static_cast<std::size_t>(parsed.get<level>(id));
+			break;
+		case value_kind::list:
+			sink += parsed.get<string_span>(id).size();
+			break;
+		case value_kind::map:
+			sink += parsed.get<flat_string_map>(id).size();
+			break;
+		}
+	}
+	return sink;
+}
+
+} // namespace
+
+void run_input(const std::uint8_t *data, std::size_t size) {
+	const std::string_view text(reinterpret_cast<const char *>(data), size);
+	const spec &options = fuzz_spec();
+	volatile std::size_t sink = 0;
+
+	// The whole input as one command string.
+	try {
+		const command_line words = split_command(text);
+		sink = sink + consume(options, parse(options, words));
+	} catch (const parse_error &) {
+	}
+
+	// The input as NUL separated arguments, where `@N` names record N as a
+	// response file. Expansion is capped in proportion to the input so the
+	// work stays linear in its size.
+	std::vector<std::string_view> records;
+	for (std::size_t pos = 0; pos <= size;) {
+		const std::size_t end = std::min(text.find('\0', pos), size);
+		records.push_back(text.substr(pos, end - pos));
+		pos = end + 1;
+	}
+	const file_loader load = [&](std::string_view path, std::size_t) -> std::optional<std::string> {
+		std::size_t index = 0;
+		const auto [ptr, ec] = std::from_chars(path.data(), path.data() + path.size(), index);
+		if (ec != std::errc() || ptr != path.data() + path.size() || index >= records.size())
+			return std::nullopt;
+		return std::string(records[index]);
+	};
+	parse_limits limits;
+	limits.max_response_depth = 8;
+	limits.max_response_bytes = 16 * size + 1024;
+	try {
+		const expanded_args expanded = expand_response_files(arg_list(records), load, limits);
+		sink = sink + consume(options, parse(options, expanded));
+		std::size_t events = 0;
+		visit(options, expanded, [&](const option_value &) { ++events; }, [&](std::string_view, std::size_t) { ++events; });
+		sink = sink + events;
+	} catch (const parse_error &) {
+	}
+
+	// Choice lookups in every match mode.
+	for (const std::string_view record : records) {
+		for (const choice_match match : {choice_match::exact, choice_match::ignore_case, choice_match::prefix})
+			sink = sink + static_cast<std::size_t>(levels.find(record, match).value_or(level::low));
+	}
+}
+
+} // namespace option_parser::fuzz
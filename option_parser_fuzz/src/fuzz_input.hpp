@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace option_parser::fuzz {
+
+// Feeds one fuzz input through the command string splitter, response file
+// expansion, the tokenizer, every value converter and the choice tables.
+// Only parse_error is an expected outcome; anything else escaping is a bug.
+void run_input(const std::uint8_t *data, std::size_t size);
+
+} // namespace option_parser::fuzz
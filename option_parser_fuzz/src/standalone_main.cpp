@@ -0,0 +1,54 @@
+// Driver for builds without libFuzzer: runs every file named on the command
+// line (directories are walked) through the fuzz target, or stdin when no
+// path is given, which is how AFL invokes a target.
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, std::size_t size);
+
+namespace {
+
+void run(std::istream &in) {
+	const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t *>(data.data()), data.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		run(std::cin);
+		return 0;
+	}
+
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; ++i) {
+		const std::filesystem::path path(argv[i]);
+		if (std::filesystem::is_directory(path)) {
+			for (const auto &entry : std::filesystem::recursive_directory_iterator(path)) {
+				if (entry.is_regular_file())
+					inputs.push_back(entry.path());
+			}
+		} else {
+			inputs.push_back(path);
+		}
+	}
+
+	for (const std::filesystem::path &path : inputs) {
+		std::ifstream in(path, std::ios::binary);
+		if (!in) {
+			std::fprintf(stderr, "cannot open %s\n", path.string().c_str());
+			return 1;
+		}
+		run(in);
+	}
+	std::printf("ran %zu inputs\n", inputs.size());
+	return 0;
+}
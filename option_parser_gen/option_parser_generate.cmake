@@ -0,0 +1,19 @@
+# option_parser_generate(<target> <spec file>)
+#
+# Runs option_parser_gen on the spec file at build time and compiles the
+# generated parser into target. Outputs are named after the spec file, so
+# server.opts gives server.hpp, which target can include directly.
+function(option_parser_generate target spec)
+	get_filename_component(spec_path ${spec} ABSOLUTE)
+	get_filename_component(name ${spec} NAME_WE)
+	set(out_dir ${CMAKE_CURRENT_BINARY_DIR}/option_parser_generated)
+	add_custom_command(
+		OUTPUT ${out_dir}/${name}.hpp ${out_dir}/${name}.cpp
+		COMMAND ${CMAKE_COMMAND} -E make_directory ${out_dir}
+		COMMAND option_parser_gen ${spec_path} ${out_dir}/${name}
+		DEPENDS option_parser_gen ${spec_path}
+		COMMENT "Generating option parser from ${spec}"
+		VERBATIM)
+	target_sources(${target} PRIVATE ${out_dir}/${name}.cpp ${out_dir}/${name}.hpp)
+	target_include_directories(${target} PRIVATE ${out_dir})
+endfunction()
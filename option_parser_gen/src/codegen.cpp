@@ -0,0 +1,516 @@
+#include "codegen.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <sstream>
+#include <vector>
+
+namespace option_parser::gen {
+
+namespace {
+
+std::string quote(std::string_view text) {
+	std::string out = "\"";
+	for (const char c : text) {
+		const auto byte = static_cast<unsigned char>(c);
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (byte < 0x20 || byte >= 0x7f) {
+			// Three digit octal escapes never run into the next character.
+			out += '\\';
+			out += static_cast<char>('0' + (byte >> 6));
+			out += static_cast<char>('0' + ((byte >> 3) & 7));
+			out += static_cast<char>('0' + (byte & 7));
+		} else {
+			out += c;
+		}
+	}
+	return out + '"';
+}
+
+std::string char_literal(char c) {
+	if (c == '\0')
+		return "'\\0'";
+	if (c == '\'' || c == '\\')
+		return std::string("'\\") + c + "'";
+	const auto byte = static_cast<unsigned char>(c);
+	if (byte < 0x20 || byte >= 0x7f) {
+		std::string out = "'\\000'";
+		out[2] = static_cast<char>('0' + (byte >> 6));
+		out[3] = static_cast<char>('0' + ((byte >> 3) & 7));
+		out[4] = static_cast<char>('0' + (byte & 7));
+		return out;
+	}
+	return std::string("'") + c + "'";
+}
+
+std::string integer_literal(std::string_view text) {
+	std::int64_t value = 0;
+	std::from_chars(text.data(), text.data() + text.size(), value);
+	if (value == INT64_MIN)
+		return "(-9223372036854775807 - 1)";
+	return std::to_string(value);
+}
+
+std::string enum_name(const option_decl &decl) {
+	return decl.field + "_choice";
+}
+
+std::string enumerator(const option_decl &decl, std::string_view value) {
+	return enum_name(decl) + "::" + identifier_for(value);
+}
+
+std::string choice_default(const option_decl &decl) {
+	return enumerator(decl, decl.has_default ? decl.default_text : decl.values[0]);
+}
+
+std::string match_name(choice_match match) {
+	switch (match) {
+	case choice_match::exact:
+		return "option_parser::choice_match::exact";
+	case choice_match::ignore_case:
+		return "option_parser::choice_match::ignore_case";
+	default:
+		return "option_parser::choice_match::prefix";
+	}
+}
+
+std::string duplicates_name(duplicate_key duplicates) {
+	switch (duplicates) {
+	case duplicate_key::last_wins:
+		return "option_parser::duplicate_key::last_wins";
+	case duplicate_key::first_wins:
+		return "option_parser::duplicate_key::first_wins";
+	default:
+		return "option_parser::duplicate_key::reject";
+	}
+}
+
+// `-v, --verbose`, as a field comment.
+std::string usage(const option_decl &decl) {
+	std::string out;
+	if (decl.short_name != '\0')
+		out = std::string("-") + decl.short_name + (decl.long_name.empty() ? "" : ", ");
+	if (!decl.long_name.empty())
+		out += "--" + decl.long_name;
+	return out;
+}
+
+// Options converted after tokenizing, from the last token that named them.
+bool converted_late(const option_decl &decl) {
+	return decl.kind == "int" || decl.kind == "double" || decl.kind == "choice" || decl.kind == "pattern";
+}
+
+struct name_entry {
+	std::string name;
+	option_id id;
+	bool deprecated;
+};
+
+std::string match_literal(const name_entry &entry) {
+	return "name_match{" + std::to_string(entry.id) + ", " + (entry.deprecated ? "true" : "false") + "}";
+}
+
+// Switches on the length of a long name, then on the byte that tells most
+// names of that length apart, and compares whatever is left.
+void emit_resolve_long(std::ostream &out, const std::vector<name_entry> &names) {
+	std::map<std::size_t, std::vector<name_entry>> by_length;
+	for (const name_entry &entry : names)
+		by_length[entry.name.size()].push_back(entry);
+
+	out << "\tstd::optional<name_match> resolve_long(std::string_view name) const noexcept {\n";
+	if (!by_length.empty()) {
+		out << "\t\tswitch (name.size()) {\n";
+		for (const auto &[length, group] : by_length) {
+			out << "\t\tcase " << length << ":\n";
+			std::size_t best = 0;
+			std::size_t best_distinct = 0;
+			for (std::size_t pos = 0; pos < length && group.size() > 1; ++pos) {
+				std::set<char> distinct;
+				for (const name_entry &entry : group)
+					distinct.insert(entry.name[pos]);
+				if (distinct.size() > best_distinct) {
+					best = pos;
+					best_distinct = distinct.size();
+				}
+			}
+			if (best_distinct < 2) {
+				for (const name_entry &entry : group)
+					out << "\t\t\tif (name == " << quote(entry.name) << ")\n\t\t\t\treturn " << match_literal(entry)
+					    << ";\n";
+				out << "\t\t\tbreak;\n";
+				continue;
+			}
+			std::map<char, std::vector<const name_entry *>> by_char;
+			for (const name_entry &entry : group)
+				by_char[entry.name[best]].push_back(&entry);
+			out << "\t\t\tswitch (name[" << best << "]) {\n";
+			for (const auto &[c, entries] : by_char) {
+				out << "\t\t\tcase " << char_literal(c) << ":\n";
+				for (const name_entry *entry : entries)
+					out << "\t\t\t\tif (name == " << quote(entry->name) << ")\n\t\t\t\t\treturn "
+					    << match_literal(*entry) << ";\n";
+				out << "\t\t\t\tbreak;\n";
+			}
+			out << "\t\t\t}\n\t\t\tbreak;\n";
+		}
+		out << "\t\t}\n";
+	}
+	out << "\t\treturn std::nullopt;\n\t}\n";
+}
+
+void emit_resolve_short(std::ostream &out, const std::vector<name_entry> &names) {
+	out << "\tstd::optional<name_match> resolve_short(char name) const noexcept {\n";
+	if (!names.empty()) {
+		out << "\t\tswitch (name) {\n";
+		for (const name_entry &entry : names)
+			out << "\t\tcase " << char_literal(entry.name[0]) << ":\n\t\t\treturn " << match_literal(entry) << ";\n";
+		out << "\t\tdefault:\n\t\t\tbreak;\n\t\t}\n";
+	} else {
+		out << "\t\tstatic_cast<void>(name);\n";
+	}
+	out << "\t\treturn std::nullopt;\n\t}\n";
+}
+
+void open_namespace(std::ostream &out, const spec_file &spec) {
+	if (!spec.namespace_name.empty())
+		out << "namespace " << spec.namespace_name << " {\n\n";
+}
+
+void close_namespace(std::ostream &out, const spec_file &spec) {
+	if (!spec.namespace_name.empty())
+		out << "} // namespace " << spec.namespace_name << "\n";
+}
+
+std::string field_declaration(const option_decl &decl) {
+	if (decl.kind == "flag")
+		return "bool " + decl.field + " = false;";
+	if (decl.kind == "int")
+		return "std::int64_t " + decl.field + " = " + (decl.has_default ? integer_literal(decl.default_text) : "0") +
+		       ";";
+	if (decl.kind == "double")
+		return "double " + decl.field + " = " + (decl.has_default ? decl.default_text : "0.0") + ";";
+	if (decl.kind == "string" || decl.kind == "pattern")
+		return "std::string_view " + decl.field + " = " + quote(decl.default_text) + ";";
+	if (decl.kind == "choice")
+		return enum_name(decl) + " " + decl.field + " = " + choice_default(decl) + ";";
+	if (decl.kind == "list")
+		return "std::vector<std::string_view> " + decl.field + ";";
+	return "option_parser::flat_string_map " + decl.field + ";";
+}
+
+std::string header(const spec_file &spec, std::string_view origin) {
+	std::ostringstream out;
+	out << "// Generated by option_parser_gen from " << origin << "; do not edit.\n\n";
+	out << "#pragma once\n\n#include <cstdint>\n#include <string_view>\n#include <vector>\n\n";
+	out << "#include \"option_parser/flat_string_map.hpp\"\n#include \"option_parser/option_parser.hpp\"\n\n";
+	open_namespace(out, spec);
+
+	for (const option_decl &decl : spec.options) {
+		if (decl.kind != "choice")
+			continue;
+		out << "enum class " << enum_name(decl) << " : std::int64_t {\n";
+		for (const std::string &value : decl.values)
+			out << "\t" << identifier_for(value) << ",\n";
+		out << "};\n\n";
+	}
+
+	out << "// Strings, list values and map entries view the parsed arguments, which\n"
+	       "// must outlive this struct.\n";
+	out << "struct " << spec.struct_name << " {\n";
+	for (const option_decl &decl : spec.options)
+		out << "\t" << field_declaration(decl) << " // " << usage(decl) << "\n";
+	out << "\tstd::vector<std::string_view> positionals;\n";
+	out << "\tstd::vector<option_parser::diagnostic> diagnostics;\n";
+	out << "};\n\n";
+
+	out << "// Parses args with the rules, errors and diagnostics of option_parser::parse\n"
+	       "// with "
+	    << spec.struct_name
+	    << "_spec() followed by result::validate, with option names\n"
+	       "// resolved by compiled switches. Throws option_parser::parse_error.\n";
+	out << spec.struct_name << " " << spec.function_name << "(option_parser::arg_list args);\n\n";
+	out << "// The same options as a runtime spec, with ids in declaration order.\n";
+	out << "option_parser::spec " << spec.struct_name << "_spec();\n";
+	if (!spec.namespace_name.empty())
+		out << "\n";
+	close_namespace(out, spec);
+	return out.str();
+}
+
+std::string source(const spec_file &spec, std::string_view header_name, std::string_view origin) {
+	const auto &options = spec.options;
+	bool has_patterns = false;
+	bool has_maps = false;
+	std::vector<std::size_t> late; // options converted at the end, by position in `last`
+	for (std::size_t i = 0; i < options.size(); ++i) {
+		has_patterns = has_patterns || options[i].kind == "pattern";
+		has_maps = has_maps || options[i].kind == "map";
+		if (converted_late(options[i]))
+			late.push_back(i);
+	}
+
+	std::ostringstream out;
+	out << "// Generated by option_parser_gen from " << origin << "; do not edit.\n\n";
+	out << "#include " << quote(header_name) << "\n\n#include <optional>\n#include <string>\n\n";
+	if (has_patterns)
+		out << "#include \"option_parser/pattern.hpp\"\n\n";
+	open_namespace(out, spec);
+	out << "namespace {\n\nusing option_parser::name_match;\nusing option_parser::option_id;\n\n";
+
+	for (const option_decl &decl : options) {
+		if (decl.kind != "choice")
+			continue;
+		out << "constexpr auto " << decl.field << "_choices = option_parser::make_choices<" << enum_name(decl)
+		    << ">({\n";
+		for (const std::string &value : decl.values)
+			out << "    {" << quote(value) << ", " << enumerator(decl, value) << "},\n";
+		out << "});\n\n";
+	}
+	for (const option_decl &decl : options) {
+		if (decl.kind != "pattern")
+			continue;
+		out << "const option_parser::string_pattern &" << decl.field << "_pattern() {\n"
+		    << "\tstatic const option_parser::string_pattern pattern(" << quote(decl.pattern) << ");\n"
+		    << "\treturn pattern;\n}\n\n";
+	}
+
+	if (!options.empty()) {
+		out << "constexpr option_parser::detail::option_label labels[] = {\n";
+		for (const option_decl &decl : options)
+			out << "    {" << quote(decl.long_name) << ", " << char_literal(decl.short_name) << "},\n";
+		out << "};\n\n";
+	}
+
+	std::vector<name_entry> long_names;
+	std::vector<name_entry> short_names;
+	for (std::size_t i = 0; i < options.size(); ++i) {
+		if (!options[i].long_name.empty())
+			long_names.push_back({options[i].long_name, static_cast<option_id>(i), false});
+		if (options[i].short_name != '\0')
+			short_names.push_back({std::string(1, options[i].short_name), static_cast<option_id>(i), false});
+	}
+	for (const alias_decl &alias : spec.aliases) {
+		if (!alias.long_name.empty())
+			long_names.push_back({alias.long_name, alias.target, alias.deprecated});
+		if (alias.short_name != '\0')
+			short_names.push_back({std::string(1, alias.short_name), alias.target, alias.deprecated});
+	}
+	std::sort(short_names.begin(), short_names.end(),
+	          [](const name_entry &a, const name_entry &b) { return a.name < b.name; });
+
+	out << "// Option names compiled into switches, for basic_tokenizer.\nstruct names {\n";
+	emit_resolve_long(out, long_names);
+	emit_resolve_short(out, short_names);
+	out << "\tbool takes_value(option_id id) const noexcept {\n";
+	std::vector<std::string> flags;
+	for (std::size_t i = 0; i < options.size(); ++i)
+		if (options[i].kind == "flag")
+			flags.push_back("id != " + std::to_string(i));
+	if (flags.empty()) {
+		out << "\t\tstatic_cast<void>(id);\n\t\treturn true;\n";
+	} else {
+		out << "\t\treturn ";
+		for (std::size_t i = 0; i < flags.size(); ++i)
+			out << (i == 0 ? "" : " && ") << flags[i];
+		out << ";\n";
+	}
+	out << "\t}\n";
+	std::vector<std::string> byte_options;
+	for (std::size_t i = 0; i < options.size(); ++i)
+		if (options[i].bytes)
+			byte_options.push_back("id == " + std::to_string(i));
+	out << "\tbool accepts_bytes(option_id id) const noexcept {\n";
+	if (byte_options.empty()) {
+		out << "\t\tstatic_cast<void>(id);\n\t\treturn false;\n";
+	} else {
+		out << "\t\treturn ";
+		for (std::size_t i = 0; i < byte_options.size(); ++i)
+			out << (i == 0 ? "" : " || ") << byte_options[i];
+		out << ";\n";
+	}
+	out << "\t}\n";
+	out << "\tbool positionals_accept_bytes() const noexcept { return " << (spec.positional_bytes ? "true" : "false")
+	    << "; }\n";
+	out << "\tstd::string display_name(option_id id) const {\n";
+	if (options.empty()) {
+		out << "\t\treturn \"#\" + std::to_string(id);\n";
+	} else {
+		out << "\t\tconst option_parser::detail::option_label &label = labels[id];\n"
+		    << "\t\tif (!label.long_name.empty())\n\t\t\treturn \"--\" + std::string(label.long_name);\n"
+		    << "\t\treturn std::string(\"-\") + label.short_name;\n";
+	}
+	out << "\t}\n};\n\n";
+
+	// Checks values overridden before they were converted, as
+	// result::validate does.
+	if (!late.empty()) {
+		out << "// Throws the parse_error converting an overridden value would.\n"
+		    << "void check_overridden(const option_parser::token &tok) {\n\tswitch (tok.id) {\n";
+		for (const std::size_t i : late) {
+			const option_decl &decl = options[i];
+			const std::string label = "labels[" + std::to_string(i) + "]";
+			out << "\tcase " << i << ":\n\t\t";
+			if (decl.kind == "int") {
+				out << "option_parser::detail::to_integer(tok, " << label << ");\n";
+			} else if (decl.kind == "double") {
+				out << "option_parser::detail::to_floating(tok, " << label << ");\n";
+			} else if (decl.kind == "choice") {
+				const std::string table = decl.field + "_choices";
+				out << "option_parser::detail::to_choice(tok, " << label << ", " << table << ".entries().data(), "
+				    << table << ".size(), " << match_name(decl.match) << ");\n";
+			} else {
+				out << "option_parser::detail::check_pattern(tok, " << label << ", " << decl.field << "_pattern());\n";
+			}
+			out << "\t\tbreak;\n";
+		}
+		out << "\tdefault:\n\t\tbreak;\n\t}\n}\n\n";
+	}
+	out << "} // namespace\n\n";
+
+	// The parse function tokenizes everything first, then inserts map pairs,
+	// then converts the last value of each converted option and checks the
+	// ones it overrode, so that errors come out as option_parser::parse and
+	// validate raise them.
+	out << spec.struct_name << " " << spec.function_name << "(option_parser::arg_list args) {\n";
+	out << "\tstatic const names lookup;\n";
+	out << "\t" << spec.struct_name << " out;\n";
+	out << "\toption_parser::basic_tokenizer<names> tokens(lookup, args" << (spec.utf8 ? ", true" : "") << ");\n";
+	out << "\toption_parser::token tok;\n";
+	if (!late.empty())
+		out << "\toption_parser::token last[" << late.size() << "];\n"
+		    << "\tstd::vector<option_parser::token> overridden;\n";
+	if (has_maps)
+		out << "\tstd::vector<option_parser::token> pairs;\n";
+	out << "\twhile (tokens.next(tok)) {\n";
+	out << "\t\tif (tok.kind == option_parser::token::type::positional) {\n"
+	       "\t\t\tout.positionals.push_back(tok.value);\n\t\t\tcontinue;\n\t\t}\n";
+	if (!spec.aliases.empty())
+		out << "\t\tif (tok.deprecated)\n\t\t\tout.diagnostics.push_back({tok.index, tok.id, "
+		       "option_parser::detail::deprecation(tok, labels[tok.id])});\n";
+	if (!options.empty()) {
+		out << "\t\tswitch (tok.id) {\n";
+		std::size_t slot = 0;
+		for (std::size_t i = 0; i < options.size(); ++i) {
+			const option_decl &decl = options[i];
+			out << "\t\tcase " << i << ": // " << usage(decl) << "\n\t\t\t";
+			if (decl.kind == "flag")
+				out << "out." << decl.field << " = true;";
+			else if (decl.kind == "string")
+				out << "out." << decl.field << " = tok.value;";
+			else if (decl.kind == "list")
+				out << "out." << decl.field << ".push_back(tok.value);";
+			else if (decl.kind == "map")
+				out << "pairs.push_back(tok);";
+			else {
+				const std::string last = "last[" + std::to_string(slot++) + "]";
+				out << "if (" << last << ".kind == option_parser::token::type::option)\n\t\t\t\toverridden.push_back("
+				    << last << ");\n\t\t\t" << last << " = tok;";
+			}
+			out << "\n\t\t\tbreak;\n";
+		}
+		out << "\t\t}\n";
+	}
+	out << "\t}\n";
+
+	if (has_maps) {
+		out << "\tfor (const option_parser::token &pair : pairs) {\n\t\tswitch (pair.id) {\n";
+		for (std::size_t i = 0; i < options.size(); ++i) {
+			const option_decl &decl = options[i];
+			if (decl.kind != "map")
+				continue;
+			out << "\t\tcase " << i << ":\n\t\t\toption_parser::detail::insert_pairs(pair, labels[" << i << "], "
+			    << char_literal(decl.separator) << ", " << duplicates_name(decl.duplicates) << ", out."
+			    << decl.field << ");\n\t\t\tbreak;\n";
+		}
+		out << "\t\t}\n\t}\n";
+	}
+
+	if (!late.empty()) {
+		out << "\toption_parser::detail::first_error error;\n"
+		    << "\tfor (const option_parser::token &old : overridden)\n"
+		    << "\t\terror.capture([&] { check_overridden(old); });\n";
+		for (std::size_t slot = 0; slot < late.size(); ++slot) {
+			const std::size_t i = late[slot];
+			const option_decl &decl = options[i];
+			const std::string tok = "last[" + std::to_string(slot) + "]";
+			const std::string label = "labels[" + std::to_string(i) + "]";
+			out << "\tif (" << tok << ".kind == option_parser::token::type::option)\n";
+			if (decl.kind == "int") {
+				out << "\t\terror.capture([&] { out." << decl.field << " = option_parser::detail::to_integer(" << tok
+				    << ", " << label << "); });\n";
+			} else if (decl.kind == "double") {
+				out << "\t\terror.capture([&] { out." << decl.field << " = option_parser::detail::to_floating(" << tok
+				    << ", " << label << "); });\n";
+			} else if (decl.kind == "choice") {
+				const std::string table = decl.field + "_choices";
+				out << "\t\terror.capture([&] {\n\t\t\tconst option_parser::choice_entry &entry = "
+				       "option_parser::detail::to_choice(\n\t\t\t    "
+				    << tok << ", " << label << ", " << table << ".entries().data(), " << table << ".size(), "
+				    << match_name(decl.match) << ");\n\t\t\tout." << decl.field << " = static_cast<"
+				    << enum_name(decl) << ">(entry.value);\n\t\t});\n";
+			} else {
+				out << "\t\terror.capture([&] {\n\t\t\toption_parser::detail::check_pattern(" << tok << ", " << label
+				    << ", " << decl.field << "_pattern());\n\t\t\tout." << decl.field << " = " << tok
+				    << ".value;\n\t\t});\n";
+			}
+		}
+		out << "\terror.rethrow();\n";
+	}
+	out << "\treturn out;\n}\n\n";
+
+	out << "option_parser::spec " << spec.struct_name << "_spec() {\n\toption_parser::spec options;\n";
+	if (spec.utf8)
+		out << "\toptions.require_utf8();\n";
+	if (spec.positional_bytes)
+		out << "\toptions.accept_positional_bytes();\n";
+	for (const option_decl &decl : options) {
+		const std::string names = quote(decl.long_name) + ", " + char_literal(decl.short_name);
+		out << "\t";
+		if (decl.kind == "flag")
+			out << "options.add_flag(" << names << ");\n";
+		else if (decl.kind == "int")
+			out << "options.add_int(" << names << ", "
+			    << (decl.has_default ? integer_literal(decl.default_text) : "0") << ");\n";
+		else if (decl.kind == "double")
+			out << "options.add_double(" << names << ", " << (decl.has_default ? decl.default_text : "0.0")
+			    << ");\n";
+		else if (decl.kind == "string")
+			out << "options.add_string(" << names << ", " << quote(decl.default_text) << ");\n";
+		else if (decl.kind == "pattern")
+			out << "options.add_pattern(" << names << ", " << quote(decl.pattern) << ", " << quote(decl.default_text)
+			    << ");\n";
+		else if (decl.kind == "choice")
+			out << "options.add_choice(" << names << ", " << decl.field << "_choices, " << choice_default(decl) << ", "
+			    << match_name(decl.match) << ");\n";
+		else if (decl.kind == "list")
+			out << "options.add_list(" << names << ");\n";
+		else
+			out << "options.add_map(" << names << ", " << char_literal(decl.separator) << ", "
+			    << duplicates_name(decl.duplicates) << ");\n";
+	}
+	for (std::size_t i = 0; i < options.size(); ++i)
+		if (options[i].bytes)
+			out << "\toptions.accept_bytes(" << i << ");\n";
+	for (const alias_decl &alias : spec.aliases)
+		out << "\toptions.add_alias(" << alias.target << ", " << quote(alias.long_name) << ", "
+		    << char_literal(alias.short_name) << ", option_parser::alias_kind::"
+		    << (alias.deprecated ? "deprecated" : "plain") << ");\n";
+	out << "\treturn options;\n}\n";
+	if (!spec.namespace_name.empty())
+		out << "\n";
+	close_namespace(out, spec);
+	return out.str();
+}
+
+} // namespace
+
+generated_files generate(const spec_file &spec, std::string_view header_name, std::string_view origin) {
+	return {header(spec, origin), source(spec, header_name, origin)};
+}
+
+} // namespace option_parser::gen
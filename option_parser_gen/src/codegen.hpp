@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "spec_file.hpp"
+
+namespace option_parser::gen {
+
+struct generated_files {
+	std::string header;
+	std::string source;
+};
+
+// C++ for a spec file: a struct with one typed field per option, a parse
+// function that fills it, and a function building the equivalent runtime
+// spec. header_name is how the source includes the header; origin is named
+// in the do-not-edit banner.
+generated_files generate(const spec_file &spec, std::string_view header_name, std::string_view origin);
+
+} // namespace option_parser::gen
@@ -0,0 +1,59 @@
+// option_parser_gen <spec file> <output base>
+//
+// Writes <output base>.hpp and <output base>.cpp for the options declared
+// in the spec file (see spec_file.hpp). Outputs whose contents would not
+// change are left untouched, so regenerating does not trigger rebuilds.
+
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "codegen.hpp"
+#include "option_parser/response_file.hpp"
+#include "spec_file.hpp"
+
+namespace {
+
+bool write_if_changed(const std::string &path, const std::string &contents) {
+	if (option_parser::read_file(path) == contents)
+		return true;
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << contents;
+	return static_cast<bool>(out.flush());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		std::cerr << "usage: option_parser_gen <spec file> <output base>\n";
+		return 2;
+	}
+	const std::string spec_path = argv[1];
+	const std::string base = argv[2];
+
+	const std::optional<std::string> text = option_parser::read_file(spec_path);
+	if (!text) {
+		std::cerr << spec_path << ": cannot read file\n";
+		return 1;
+	}
+	option_parser::gen::spec_file spec;
+	try {
+		spec = option_parser::gen::read_spec_file(*text);
+	} catch (const std::invalid_argument &e) {
+		std::cerr << spec_path << ": " << e.what() << "\n";
+		return 1;
+	}
+
+	const std::string origin = spec_path.substr(spec_path.find_last_of('/') + 1);
+	const std::string header_name = base.substr(base.find_last_of('/') + 1) + ".hpp";
+	const option_parser::gen::generated_files files = option_parser::gen::generate(spec, header_name, origin);
+	for (const auto &[path, contents] : {std::pair(base + ".hpp", &files.header), std::pair(base + ".cpp", &files.source)}) {
+		if (!write_if_changed(path, *contents)) {
+			std::cerr << path << ": cannot write file\n";
+			return 1;
+		}
+	}
+	return 0;
+}
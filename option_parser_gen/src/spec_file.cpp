@@ -0,0 +1,332 @@
+#include "spec_file.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include "option_parser/command_line.hpp"
+
+namespace option_parser::gen {
+
+namespace {
+
+[[noreturn]] void fail(std::size_t line, const std::string &message) {
+	throw std::invalid_argument("line " + std::to_string(line) + ": " + message);
+}
+
+bool is_identifier(std::string_view name) noexcept {
+	if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+		return false;
+	for (const char c : name)
+		if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'))
+			return false;
+	return true;
+}
+
+bool is_qualified_identifier(std::string_view name) noexcept {
+	for (;;) {
+		const std::size_t sep = name.find("::");
+		if (!is_identifier(name.substr(0, sep)))
+			return false;
+		if (sep == std::string_view::npos)
+			return true;
+		name.remove_prefix(sep + 2);
+	}
+}
+
+std::vector<std::string> split_list(std::string_view text) {
+	std::vector<std::string> out;
+	for (;;) {
+		const std::size_t comma = text.find(',');
+		out.emplace_back(text.substr(0, comma));
+		if (comma == std::string_view::npos)
+			return out;
+		text.remove_prefix(comma + 1);
+	}
+}
+
+char single_char(std::size_t line, std::string_view key, std::string_view value) {
+	if (value.size() != 1)
+		fail(line, std::string(key) + " must be a single character");
+	return value[0];
+}
+
+choice_match match_mode(std::size_t line, std::string_view value) {
+	if (value == "exact")
+		return choice_match::exact;
+	if (value == "ignore_case")
+		return choice_match::ignore_case;
+	if (value == "prefix")
+		return choice_match::prefix;
+	fail(line, "match must be exact, ignore_case or prefix");
+}
+
+duplicate_key duplicate_mode(std::size_t line, std::string_view value) {
+	if (value == "last_wins")
+		return duplicate_key::last_wins;
+	if (value == "first_wins")
+		return duplicate_key::first_wins;
+	if (value == "reject")
+		return duplicate_key::reject;
+	fail(line, "duplicates must be last_wins, first_wins or reject");
+}
+
+bool is_option_kind(std::string_view kind) noexcept {
+	for (const char *known : {"flag", "int", "double", "string", "pattern", "choice", "list", "map"})
+		if (kind == known)
+			return true;
+	return false;
+}
+
+// Which attributes, and the bare `bytes`, an option kind takes besides short
+// and field.
+bool allows(std::string_view kind, std::string_view key) noexcept {
+	if (key == "default")
+		return kind != "flag" && kind != "list" && kind != "map";
+	if (key == "pattern")
+		return kind == "pattern";
+	if (key == "values" || key == "match")
+		return kind == "choice";
+	if (key == "separator" || key == "duplicates")
+		return kind == "map";
+	if (key == "bytes")
+		return kind == "string" || kind == "pattern" || kind == "list" || kind == "map";
+	return key == "short" || key == "field";
+}
+
+option_decl read_option(std::size_t line, const command_line &words) {
+	option_decl decl;
+	decl.line = line;
+	decl.kind = std::string(words[0]);
+	if (words.size() < 2)
+		fail(line, decl.kind + " needs a long name");
+	decl.long_name = std::string(words[1]);
+	decl.field = identifier_for(decl.long_name);
+
+	for (std::size_t i = 2; i < words.size(); ++i) {
+		const std::string_view word = words[i];
+		if (word == "bytes") {
+			if (!allows(decl.kind, word))
+				fail(line, decl.kind + " options cannot accept bytes");
+			decl.bytes = true;
+			continue;
+		}
+		const std::size_t eq = word.find('=');
+		if (eq == std::string_view::npos)
+			fail(line, "expected key=value, got '" + std::string(word) + "'");
+		const std::string_view key = word.substr(0, eq);
+		const std::string_view value = word.substr(eq + 1);
+		if (!allows(decl.kind, key))
+			fail(line, decl.kind + " options take no " + std::string(key));
+		if (key == "short") {
+			decl.short_name = single_char(line, key, value);
+		} else if (key == "field") {
+			decl.field = std::string(value);
+		} else if (key == "default") {
+			decl.default_text = std::string(value);
+			decl.has_default = true;
+		} else if (key == "pattern") {
+			decl.pattern = std::string(value);
+		} else if (key == "values") {
+			decl.values = split_list(value);
+		} else if (key == "match") {
+			decl.match = match_mode(line, value);
+		} else if (key == "separator") {
+			decl.separator = single_char(line, key, value);
+		} else {
+			decl.duplicates = duplicate_mode(line, value);
+		}
+	}
+
+	if (!is_identifier(decl.field) || is_keyword(decl.field))
+		fail(line, "'" + decl.field + "' is not a valid field name; give one with field=");
+	if (decl.kind == "choice") {
+		if (decl.values.empty() || decl.values[0].empty())
+			fail(line, "choice options need values=");
+		for (std::size_t i = 0; i < decl.values.size(); ++i) {
+			if (!is_identifier(identifier_for(decl.values[i])))
+				fail(line, "choice value '" + decl.values[i] + "' is not a valid identifier");
+			for (std::size_t j = 0; j < i; ++j)
+				if (detail::compare_folded(decl.values[i], decl.values[j]) == 0 ||
+				    identifier_for(decl.values[i]) == identifier_for(decl.values[j]))
+					fail(line, "choice value '" + decl.values[i] + "' is given twice");
+		}
+		if (decl.has_default) {
+			bool known = false;
+			for (const std::string &value : decl.values)
+				known = known || value == decl.default_text;
+			if (!known)
+				fail(line, "default '" + decl.default_text + "' is not one of the values");
+		}
+	}
+	if (decl.kind == "pattern" && decl.pattern.empty())
+		fail(line, "pattern options need pattern=");
+	if (decl.has_default && decl.kind == "int") {
+		std::int64_t value = 0;
+		const char *end = decl.default_text.data() + decl.default_text.size();
+		const auto [ptr, ec] = std::from_chars(decl.default_text.data(), end, value);
+		if (ec != std::errc() || ptr != end)
+			fail(line, "default '" + decl.default_text + "' is not a 64-bit integer");
+	}
+	if (decl.has_default && decl.kind == "double") {
+		double value = 0;
+		const char *end = decl.default_text.data() + decl.default_text.size();
+		const auto [ptr, ec] = std::from_chars(decl.default_text.data(), end, value);
+		if (ec != std::errc() || ptr != end || !std::isfinite(value))
+			fail(line, "default '" + decl.default_text + "' is not a finite number");
+	}
+	return decl;
+}
+
+alias_decl read_alias(std::size_t line, const command_line &words, const spec &options) {
+	alias_decl decl;
+	decl.line = line;
+	if (words.size() < 2)
+		fail(line, "alias needs the long name of its option");
+	const std::optional<option_id> target = options.find_long(words[1]);
+	if (!target)
+		fail(line, "alias of unknown option '" + std::string(words[1]) + "'");
+	decl.target = *target;
+
+	for (std::size_t i = 2; i < words.size(); ++i) {
+		const std::string_view word = words[i];
+		if (word == "deprecated") {
+			decl.deprecated = true;
+			continue;
+		}
+		const std::size_t eq = word.find('=');
+		const std::string_view key = word.substr(0, eq);
+		if (eq == std::string_view::npos || (key != "long" && key != "short"))
+			fail(line, "alias takes long=, short= and deprecated, got '" + std::string(word) + "'");
+		if (key == "long")
+			decl.long_name = std::string(word.substr(eq + 1));
+		else
+			decl.short_name = single_char(line, key, word.substr(eq + 1));
+	}
+	if (decl.long_name.empty() && decl.short_name == '\0')
+		fail(line, "alias needs long= or short=");
+	return decl;
+}
+
+// Adds decl to options, which rejects what a runtime spec would.
+void add_to(spec &options, const option_decl &decl) try {
+	if (decl.kind == "flag") {
+		options.add_flag(decl.long_name, decl.short_name);
+	} else if (decl.kind == "int" || decl.kind == "double" || decl.kind == "choice") {
+		// Defaults were checked above; only the names matter here.
+		options.add_flag(decl.long_name, decl.short_name);
+	} else if (decl.kind == "string") {
+		options.add_string(decl.long_name, decl.short_name, decl.default_text);
+	} else if (decl.kind == "pattern") {
+		options.add_pattern(decl.long_name, decl.short_name, decl.pattern, decl.default_text);
+	} else if (decl.kind == "list") {
+		options.add_list(decl.long_name, decl.short_name);
+	} else {
+		options.add_map(decl.long_name, decl.short_name, decl.separator, decl.duplicates);
+	}
+} catch (const std::invalid_argument &e) {
+	fail(decl.line, e.what());
+}
+
+} // namespace
+
+bool is_keyword(std::string_view name) noexcept {
+	static constexpr std::string_view keywords[] = {
+	    "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case", "catch",
+	    "char", "char16_t", "char32_t", "class", "compl", "const", "const_cast", "constexpr", "continue",
+	    "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+	    "extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable",
+	    "namespace", "new", "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private",
+	    "protected", "public", "register", "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+	    "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+	    "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+	    "wchar_t", "while", "xor", "xor_eq"};
+	for (const std::string_view keyword : keywords)
+		if (name == keyword)
+			return true;
+	return false;
+}
+
+// Identifier for a name that may contain '-' or be a keyword.
+std::string identifier_for(std::string_view name) {
+	std::string out(name);
+	for (char &c : out)
+		if (c == '-')
+			c = '_';
+	if (is_keyword(out))
+		out += '_';
+	return out;
+}
+
+spec_file read_spec_file(std::string_view text) {
+	spec_file out;
+	spec names; // catches duplicate and malformed names the way a runtime spec does
+	std::size_t line = 0;
+	while (!text.empty()) {
+		++line;
+		const std::size_t newline = text.find('\n');
+		const std::string_view content = text.substr(0, newline);
+		text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+
+		command_line words;
+		try {
+			words = split_command(content);
+		} catch (const parse_error &e) {
+			fail(line, e.what());
+		}
+		if (words.size() == 0)
+			continue;
+
+		const std::string_view directive = words[0];
+		if (directive == "namespace" || directive == "struct" || directive == "function") {
+			if (words.size() != 2)
+				fail(line, std::string(directive) + " takes one name");
+			const std::string_view name = words[1];
+			if (directive == "namespace") {
+				if (!is_qualified_identifier(name))
+					fail(line, "'" + std::string(name) + "' is not a namespace name");
+				out.namespace_name = std::string(name);
+			} else {
+				if (!is_identifier(name))
+					fail(line, "'" + std::string(name) + "' is not an identifier");
+				(directive == "struct" ? out.struct_name : out.function_name) = std::string(name);
+			}
+		} else if (directive == "utf8") {
+			if (words.size() != 1)
+				fail(line, "utf8 takes no arguments");
+			out.utf8 = true;
+		} else if (directive == "positional_bytes") {
+			if (words.size() != 1)
+				fail(line, "positional_bytes takes no arguments");
+			out.positional_bytes = true;
+		} else if (directive == "alias") {
+			alias_decl decl = read_alias(line, words, names);
+			try {
+				names.add_alias(decl.target, decl.long_name, decl.short_name);
+			} catch (const std::invalid_argument &e) {
+				fail(line, e.what());
+			}
+			out.aliases.push_back(std::move(decl));
+		} else if (is_option_kind(directive)) {
+			option_decl decl = read_option(line, words);
+			for (const option_decl &other : out.options)
+				if (other.field == decl.field)
+					fail(line, "field '" + decl.field + "' is already used by --" + other.long_name);
+			if (decl.field == "positionals" || decl.field == "diagnostics")
+				fail(line, "field '" + decl.field + "' is reserved");
+			add_to(names, decl);
+			out.options.push_back(std::move(decl));
+		} else {
+			fail(line, "unknown directive '" + std::string(directive) + "'");
+		}
+	}
+
+	if (out.struct_name.empty())
+		throw std::invalid_argument("the spec needs a struct line");
+	if (out.function_name.empty())
+		out.function_name = "parse_" + out.struct_name;
+	return out;
+}
+
+} // namespace option_parser::gen
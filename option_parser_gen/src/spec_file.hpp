@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser::gen {
+
+// One option of a spec file.
+struct option_decl {
+	std::size_t line = 0;
+	std::string kind; // flag, int, double, string, pattern, choice, list or map
+	std::string long_name;
+	char short_name = '\0';
+	std::string field; // member of the generated struct
+	std::string default_text;
+	bool has_default = false;
+	std::string pattern;
+	std::vector<std::string> values; // choice names, in declaration order
+	choice_match match = choice_match::exact;
+	char separator = '\0';
+	duplicate_key duplicates = duplicate_key::last_wins;
+	bool bytes = false; // values exempt from utf8
+};
+
+struct alias_decl {
+	std::size_t line = 0;
+	option_id target = 0;
+	std::string long_name;
+	char short_name = '\0';
+	bool deprecated = false;
+};
+
+// A declarative option spec. The format is line based; each line is split
+// into words with shell quoting (see split_command), and `#` starts a
+// comment:
+//
+//   namespace demo
+//   struct server_options
+//   flag    verbose short=v
+//   int     jobs    short=j default=4
+//   pattern host    pattern='[a-z0-9.-]{1,63}' default=localhost
+//   choice  level   values=low,mid,high match=ignore_case
+//   map     label   short=l separator=, duplicates=reject
+//   alias   jobs    long=threads short=T deprecated
+//
+// `function` names the parse function (parse_<struct> by default), and a
+// `utf8` line makes it reject arguments that are not valid UTF-8, as
+// spec::require_utf8 does, except for positionals after a
+// `positional_bytes` line and values of options marked `bytes`. Option
+// lines start with the kind and the long name and take key=value
+// attributes: short, field, default, and per kind pattern, values, match,
+// separator and duplicates; string, pattern, list and map options also take
+// a bare `bytes`.
+struct spec_file {
+	std::string namespace_name;
+	std::string struct_name;
+	std::string function_name;
+	bool utf8 = false;
+	bool positional_bytes = false;
+	std::vector<option_decl> options;
+	std::vector<alias_decl> aliases;
+};
+
+bool is_keyword(std::string_view name) noexcept;
+
+// C++ identifier for an option or choice name: '-' becomes '_', and
+// keywords get a trailing '_'.
+std::string identifier_for(std::string_view name);
+
+// Parses and checks a spec file, including everything a runtime spec built
+// from it would reject. Throws std::invalid_argument with the line number.
+spec_file read_spec_file(std::string_view text);
+
+} // namespace option_parser::gen
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/option_parser.hpp"
+#include "option_parser/response_file.hpp"
+#include "option_parser/snapshot.hpp"
+
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// Every byte value, NUL included, in order.
+std::string every_byte() {
+	std::string out;
+	for (int c = 0; c < 256; ++c)
+		out += static_cast<char>(c);
+	return out;
+}
+
+// Every byte but those with a meaning inside a map value.
+std::string every_byte_but(std::string_view excluded) {
+	std::string out;
+	for (const char c : every_byte())
+		if (excluded.find(c) == std::string_view::npos)
+			out += c;
+	return out;
+}
+
+// A backup tool's options: file names are bytes, the rest is text.
+struct backup_spec {
+	spec options;
+	option_id verbose = options.add_flag("verbose", 'v');
+	option_id target = options.add_string("target", 't');
+	option_id exclude = options.add_list("exclude", 'x');
+	option_id rename = options.add_map("rename", 'r', ',');
+	option_id comment = options.add_string("comment", 'c');
+	option_id level = options.add_int("level", 'l');
+
+	explicit backup_spec(bool utf8) {
+		options.require_utf8(utf8);
+		if (utf8) {
+			options.accept_bytes(target);
+			options.accept_bytes(exclude);
+			options.accept_bytes(rename);
+			options.accept_positional_bytes();
+		}
+		options.seal();
+	}
+};
+
+std::optional<error_code> error_of(const spec &options, const std::vector<std::string_view> &args) {
+	try {
+		parse(options, arg_list(args)).validate();
+	} catch (const parse_error &e) {
+		return e.code();
+	}
+	return std::nullopt;
+}
+
+} // namespace
+
+// Values view the arguments they came from, so every byte, NUL included,
+// comes back unchanged and uncopied.
+TEST(ByteArgumentsTest, ValuesViewTheArgumentsByteForByte) {
+	for (const bool utf8 : {false, true}) {
+		SCOPED_TRACE(utf8);
+		const backup_spec s(utf8);
+		const std::string bytes = every_byte();
+		const std::string pair = every_byte_but("=,") + "=" + every_byte_but(",");
+		const std::string target = "--target=" + bytes;
+		const std::string cluster = "-vx" + bytes;
+		const std::string rename = "-r" + pair + "," + pair;
+		const std::vector<std::string_view> args{target, cluster, "-x", bytes, rename, bytes, "--", "-" + bytes};
+		const result parsed = parse(s.options, arg_list(args));
+
+		const std::string_view got = parsed.get<std::string_view>(s.target);
+		EXPECT_EQ(got, bytes);
+		EXPECT_EQ(got.data(), args[0].data() + 9);
+
+		const string_span excluded = parsed.get<string_span>(s.exclude);
+		ASSERT_EQ(excluded.size(), 2u);
+		EXPECT_EQ(excluded[0], bytes);
+		EXPECT_EQ(excluded[0].data(), args[1].data() + 3);
+		EXPECT_EQ(excluded[1].data(), args[3].data());
+
+		const flat_string_map &renamed = parsed.get<flat_string_map>(s.rename);
+		ASSERT_EQ(renamed.size(), 1u);
+		EXPECT_EQ(renamed.begin()->key, every_byte_but("=,"));
+		EXPECT_EQ(renamed.begin()->value, every_byte_but(","));
+
+		ASSERT_EQ(parsed.positionals().size(), 2u);
+		EXPECT_EQ(parsed.positionals()[0].data(), args[5].data());
+		EXPECT_EQ(parsed.positionals()[1], args[7]);
+	}
+}
+
+TEST(ByteArgumentsTest, RequiredUtf8SparesOnlyWhatAcceptsBytes) {
+	const backup_spec s(true);
+	const std::string_view bad = "\xff\xfe/\xc3";
+	const std::string target = "--target=" + std::string(bad);
+	const std::string comment = "--comment=" + std::string(bad);
+	const std::string short_target = "-vt" + std::string(bad);
+	const std::string short_comment = "-vc" + std::string(bad);
+	const std::string bad_name = "--target" + std::string(bad);
+	const std::string bad_flag = "-v" + std::string(bad);
+
+	EXPECT_EQ(error_of(s.options, {target, short_target, "-t", bad, "--exclude", bad, bad}), std::nullopt);
+	EXPECT_EQ(error_of(s.options, {"-x", bad, "--", bad}), std::nullopt);
+
+	EXPECT_EQ(error_of(s.options, {comment}), error_code::invalid_encoding);
+	EXPECT_EQ(error_of(s.options, {short_comment}), error_code::invalid_encoding);
+	EXPECT_EQ(error_of(s.options, {"-c", bad}), error_code::invalid_encoding);
+	EXPECT_EQ(error_of(s.options, {"--level", bad}), error_code::invalid_encoding);
+	// Names are never spared, nor are letters that name no option.
+	EXPECT_EQ(error_of(s.options, {bad_name}), error_code::invalid_encoding);
+	EXPECT_EQ(error_of(s.options, {bad_flag}), error_code::invalid_encoding);
+	EXPECT_EQ(error_of(s.options, {"--tar\xff=x"}), error_code::invalid_encoding);
+
+	try {
+		parse(s.options, arg_list(std::vector<std::string_view>{"-v", short_comment}));
+		FAIL();
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.index(), 1u);
+		EXPECT_STREQ(e.what(), "argument 1 is not valid UTF-8 at byte 3");
+	}
+}
+
+// Random byte strings, anywhere in the argument list, parse the same with
+// and without a UTF-8 requirement wherever they are spared from it.
+TEST(ByteArgumentsTest, RandomBytesPassThrough) {
+	const backup_spec text(false);
+	const backup_spec checked(true);
+	std::mt19937 random(50);
+	std::uniform_int_distribution<int> byte(0, 255);
+	std::uniform_int_distribution<std::size_t> length(0, 12);
+	for (int i = 0; i < 2000; ++i) {
+		std::string path;
+		for (std::size_t n = length(random); n > 0; --n)
+			path += static_cast<char>(byte(random));
+		const std::string target = "--target=" + path;
+		const std::vector<std::string_view> args{target, "-x", path, "--", path};
+		const result a = parse(text.options, arg_list(args));
+		const result b = parse(checked.options, arg_list(args));
+		ASSERT_EQ(a.get<std::string_view>(text.target), path);
+		ASSERT_EQ(b.get<std::string_view>(checked.target), path);
+		ASSERT_EQ(b.get<string_span>(checked.exclude)[0], path);
+		ASSERT_EQ(b.positionals(), a.positionals());
+	}
+}
+
+TEST(ByteArgumentsTest, SurvivesResponseFilesAndSnapshots) {
+	const backup_spec s(true);
+	const std::string high = every_byte_but(std::string_view("\0\t\n\v\f\r \"#'\\", 11));
+	const file_loader load = [&](std::string_view, std::size_t) -> std::optional<std::string> {
+		return "--target " + high + " -x '" + high + "'";
+	};
+	const expanded_args expanded = expand_response_files(arg_list(std::vector<std::string_view>{"@list"}), load);
+	const result parsed = parse(s.options, expanded);
+	EXPECT_EQ(parsed.get<std::string_view>(s.target), high);
+	EXPECT_EQ(parsed.get<string_span>(s.exclude)[0], high);
+
+	const std::string_view nul("a\0b", 3);
+	const std::string bytes = every_byte();
+	const std::vector<std::string_view> args{"-t", bytes, "-x", nul, bytes};
+	const std::string saved = save_snapshot(parse(s.options, arg_list(args)));
+	const result restored = restore_snapshot(s.options, saved);
+	EXPECT_EQ(restored.get<std::string_view>(s.target), bytes);
+	EXPECT_EQ(restored.get<string_span>(s.exclude)[0], nul);
+	EXPECT_EQ(restored.positionals()[0], bytes);
+}
+
+TEST(ByteArgumentsTest, OnlyTextOptionsAcceptBytes) {
+	spec options;
+	const option_id flag = options.add_flag("flag");
+	const option_id count = options.add_int("count");
+	const option_id path = options.add_pattern("path", 'p', "[^\\n]*");
+	EXPECT_THROW(options.accept_bytes(flag), std::invalid_argument);
+	EXPECT_THROW(options.accept_bytes(count), std::invalid_argument);
+	EXPECT_THROW(options.accept_bytes(7), std::out_of_range);
+	options.accept_bytes(path);
+	EXPECT_TRUE(options.accepts_bytes(path));
+	EXPECT_FALSE(options.accepts_bytes(count));
+	options.seal();
+	EXPECT_THROW(options.accept_bytes(path), std::logic_error);
+	EXPECT_THROW(options.accept_positional_bytes(), std::logic_error);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/command_line.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+struct split_case {
+	std::string_view input;
+	std::vector<std::string_view> expected;
+};
+
+// Expected words were checked against bash with globbing disabled.
+const std::vector<split_case> conformance = {
+    {"", {}},
+    {"   \t\n ", {}},
+    {"a b c", {"a", "b", "c"}},
+    {"  leading and trailing  ", {"leading", "and", "trailing"}},
+    {"tab\tseparated\twords", {"tab", "separated", "words"}},
+    {"new\nline", {"new", "line"}},
+    {"'single quoted'", {"single quoted"}},
+    {"\"double quoted\"", {"double quoted"}},
+    {R"(mixed'single'"double"plain)", {"mixedsingledoubleplain"}},
+    {"''", {""}},
+    {"\"\"", {""}},
+    {"a '' b", {"a", "", "b"}},
+    {R"('it'\''s')", {"it's"}},
+    {R"("a \"quoted\" word")", {"a \"quoted\" word"}},
+    {R"("back\\slash")", {"back\\slash"}},
+    {R"("keep \n and \a")", {"keep \\n and \\a"}},
+    {R"('no \escapes \\ here')", {"no \\escapes \\\\ here"}},
+    {R"(\ escaped\ space)", {" escaped space"}},
+    {R"(a\\b)", {"a\\b"}},
+    {R"(\'\")", {"'\""}},
+    {R"("\$HOME")", {"$HOME"}},
+    {"'$HOME'", {"$HOME"}},
+    {"$HOME", {"$HOME"}},
+    {R"("dollar\$")", {"dollar$"}},
+    {R"("\`")", {"`"}},
+    {R"("\x")", {"\\x"}},
+    {R"(\x\y\z)", {"xyz"}},
+    {"a#b", {"a#b"}},
+    {"# whole line comment", {}},
+    {"word # trailing comment", {"word"}},
+    {"one # comment\ntwo", {"one", "two"}},
+    {"\"# not a comment\"", {"# not a comment"}},
+    {"'#' #", {"#"}},
+    {"--opt=value", {"--opt=value"}},
+    {"--opt=\"two words\"", {"--opt=two words"}},
+    {"-I'/usr/include'", {"-I/usr/include"}},
+    {"\"multi\nline\"", {"multi\nline"}},
+    {R"("a"'b'c\d)", {"abcd"}},
+    {"\"tab\tinside\"", {"tab\tinside"}},
+    {"a\\\nb", {"ab"}},
+    {"one \\\n two", {"one", "two"}},
+    {"x \"a\\\nb\"", {"x", "ab"}},
+    {"\\\n", {}},
+    {"'a''b'", {"ab"}},
+    {R"("\"x")", {"\"x"}},
+    {"'' ''", {"", ""}},
+    {"\xff\xfe 'caf\xc3\xa9'", {"\xff\xfe", "caf\xc3\xa9"}},
+};
+
+} // namespace
+
+TEST(SplitCommandTest, ConformanceTable) {
+	for (const split_case &c : conformance) {
+		const command_line words = split_command(c.input);
+		EXPECT_EQ(words.args(), c.expected) << "input: " << c.input;
+	}
+}
+
+TEST(SplitCommandTest, ReportsQuotingErrorsWithOffset) {
+	const auto offset_of = [](std::string_view input) -> std::size_t {
+		try {
+			split_command(input);
+		} catch (const parse_error &e) {
+			EXPECT_EQ(e.code(), error_code::bad_quoting);
+			return e.index();
+		}
+		ADD_FAILURE() << "expected a parse_error for " << input;
+		return 0;
+	};
+	EXPECT_EQ(offset_of("a 'open"), 2u);
+	EXPECT_EQ(offset_of("ab \"open \\\""), 3u);
+	EXPECT_EQ(offset_of("trailing\\"), 8u);
+	EXPECT_EQ(offset_of("'closed' \"x"), 9u);
+}
+
+TEST(SplitCommandTest, ViewsTextUnlessUnescapingIsNeeded) {
+	const std::string text = R"(plain 'quoted' "dq" -I'dir' a\ b "x\"y" '')";
+	const command_line words = split_command(text);
+	ASSERT_EQ(words.size(), 7u);
+	EXPECT_EQ(words[0].data(), text.data());
+	EXPECT_EQ(words[1].data(), text.data() + 7);
+	EXPECT_EQ(words[2].data(), text.data() + 16);
+	EXPECT_FALSE(words.copied(0));
+	EXPECT_FALSE(words.copied(1));
+	EXPECT_FALSE(words.copied(2));
+	EXPECT_TRUE(words.copied(3));
+	EXPECT_TRUE(words.copied(4));
+	EXPECT_TRUE(words.copied(5));
+	EXPECT_EQ(words[3], "-Idir");
+	EXPECT_EQ(words[4], "a b");
+	EXPECT_EQ(words[5], "x\"y");
+	EXPECT_EQ(words[6], "");
+}
+
+TEST(SplitCommandTest, NoCopyBufferForPlainText) {
+	const command_line words = split_command("--jobs 8 -v 'input file'");
+	for (std::size_t i = 0; i < words.size(); ++i)
+		EXPECT_FALSE(words.copied(i));
+}
+
+TEST(SplitCommandTest, MovingKeepsViewsValid) {
+	command_line words = split_command(R"(a\ b "c d")");
+	const std::string_view first = words[0];
+	command_line moved = std::move(words);
+	EXPECT_EQ(moved[0].data(), first.data());
+	EXPECT_EQ(moved[0], "a b");
+	EXPECT_EQ(moved[1], "c d");
+}
+
+TEST(SplitCommandTest, FeedsTheParser) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	const option_id name = options.add_string("name");
+	const command_line words = split_command(R"(-j 4 --name="nightly build" 'my file')");
+	const result parsed = parse(options, words);
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 4);
+	EXPECT_EQ(parsed.get<std::string_view>(name), "nightly build");
+	EXPECT_EQ(parsed.positionals(), (std::vector<std::string_view>{"my file"}));
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/command_line.hpp"
+#include "option_parser/option_parser.hpp"
+#include "option_parser/response_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// Inputs grow by this factor between the two measurements; linear work
+// may grow by at most slack times as much. Quadratic work grows by the
+// factor squared, far above the bound. Runs faster than floor_seconds are
+// timer noise, so the bound never drops below growth squared times that.
+// These tests are registered under the ctest label "complexity"; leave them
+// out on loaded machines with ctest -LE complexity.
+constexpr std::size_t growth = 8;
+constexpr double slack = 3.0;
+constexpr double floor_seconds = 0.002;
+
+template <typename Fn>
+double best_seconds(Fn &&fn) {
+	double best = 1e9;
+	for (int run = 0; run < 5; ++run) {
+		const auto start = std::chrono::steady_clock::now();
+		fn();
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+// Times run(make(n)) against run(make(n * growth)).
+template <typename Make, typename Run>
+void expect_linear(std::size_t n, Make &&make, Run &&run) {
+	const auto small = make(n);
+	const auto large = make(n * growth);
+	const double small_time = best_seconds([&] { run(small); });
+	const double large_time = best_seconds([&] { run(large); });
+	EXPECT_LT(large_time, std::max(small_time * growth * slack, floor_seconds * growth * growth))
+	    << "n=" << n << " took " << small_time << "s, n=" << n * growth << " took " << large_time << "s";
+}
+
+struct args_storage {
+	std::vector<std::string> storage;
+	std::vector<std::string_view> views;
+
+	void push(std::string arg) { storage.push_back(std::move(arg)); }
+	arg_list list() {
+		views.assign(storage.begin(), storage.end());
+		return arg_list(views);
+	}
+};
+
+} // namespace
+
+TEST(ComplexityTest, HugeShortCluster) {
+	spec options;
+	options.add_flag("verbose", 'v');
+	options.add_flag("quiet", 'q');
+	options.add_string("name", 'n');
+	expect_linear(
+	    20000, [](std::size_t n) { return "-" + std::string(n, 'v') + "q" + std::string(n, 'q') + "nvalue"; },
+	    [&](const std::string &cluster) {
+		    const std::vector<std::string_view> args{cluster};
+		    parse(options, arg_list(args));
+	    });
+}
+
+TEST(ComplexityTest, ManyAmbiguousChoicePrefixes) {
+	// n names sharing long prefixes in both cases, so prefix matching has to
+	// look past case-mismatched neighbours before declaring ambiguity. Each
+	// input is a prefix of about n / 9 names, and the table grows with the
+	// inputs, so a scan over every name sharing the prefix would be caught.
+	struct table {
+		std::vector<std::string> names;
+		std::vector<choice_entry> entries;
+		std::vector<std::string> inputs;
+	};
+	expect_linear(
+	    2000,
+	    [](std::size_t n) {
+		    table t;
+		    for (std::size_t i = 0; i < n; ++i)
+			    t.names.push_back(std::string(i % 2 ? "Shared-" : "shared-") + std::to_string(i));
+		    for (const std::string &name : t.names)
+			    t.entries.push_back({name, 0});
+		    std::sort(t.entries.begin(), t.entries.end(), [](const choice_entry &a, const choice_entry &b) {
+			    return detail::compare_folded(a.name, b.name) < 0;
+		    });
+		    for (std::size_t i = 0; i < n; ++i)
+			    t.inputs.push_back(i % 2 ? "shared-1" : "Shared-2");
+		    return t;
+	    },
+	    [](const table &t) {
+		    std::size_t ambiguous = 0;
+		    for (const std::string &input : t.inputs)
+			    ambiguous += find_choice(t.entries.data(), t.entries.size(), input, choice_match::prefix).candidates > 1;
+		    EXPECT_EQ(ambiguous, t.inputs.size());
+	    });
+}
+
+TEST(ComplexityTest, LongTokensWithoutEquals) {
+	spec options;
+	options.add_string("name", 'n');
+	options.add_list("include", 'I');
+	expect_linear(
+	    50000,
+	    [](std::size_t n) {
+		    args_storage args;
+		    args.push("--name");
+		    args.push(std::string(n, 'x'));
+		    args.push("-I" + std::string(n, 'y'));
+		    args.push(std::string(n, 'z'));
+		    args.push("--" + std::string(n, 'n'));
+		    return args;
+	    },
+	    [&](args_storage args) { EXPECT_THROW(parse(options, args.list()), parse_error); });
+}
+
+TEST(ComplexityTest, ManyArgumentsAndMapKeys) {
+	spec options;
+	options.add_map("label", 'l', ',');
+	options.add_list("include", 'I');
+	options.add_int("jobs", 'j');
+	expect_linear(
+	    2000,
+	    [](std::size_t n) {
+		    args_storage args;
+		    std::string labels = "--label=";
+		    for (std::size_t i = 0; i < n; ++i) {
+			    args.push("-Idir" + std::to_string(i));
+			    args.push("-j" + std::to_string(i));
+			    labels += "key" + std::to_string(i) + "=v,";
+		    }
+		    labels += "last=v";
+		    args.push(labels);
+		    return args;
+	    },
+	    [&](args_storage args) { parse(options, args.list()); });
+}
+
+TEST(ComplexityTest, DeeplyNestedResponseFiles) {
+	// A chain of files nested to the depth limit, each holding a share of
+	// the words, plus a file naming the tail of the chain repeatedly. Work
+	// is linear in the bytes read, which the limits bound.
+	expect_linear(
+	    2000,
+	    [](std::size_t n) {
+		    std::map<std::string, std::string, std::less<>> files;
+		    const std::size_t depth = 15;
+		    for (std::size_t level = 0; level < depth; ++level) {
+			    std::string text;
+			    for (std::size_t i = 0; i < n / depth; ++i)
+				    text += "--word \"quoted value\" ";
+			    if (level + 1 < depth)
+				    text += "@f" + std::to_string(level + 1);
+			    files["f" + std::to_string(level)] = text;
+		    }
+		    std::string fan;
+		    for (int i = 0; i < 20; ++i)
+			    fan += "@f10 ";
+		    files["fan"] = fan;
+		    return files;
+	    },
+	    [](const std::map<std::string, std::string, std::less<>> &files) {
+		    const file_loader load = [&](std::string_view path, std::size_t) -> std::optional<std::string> {
+			    return files.find(path)->second;
+		    };
+		    const std::vector<std::string_view> args{"@f0", "@fan"};
+		    parse_limits limits;
+		    limits.max_response_bytes = std::size_t{1} << 30;
+		    expand_response_files(arg_list(args), load, limits);
+	    });
+}
+
+TEST(ComplexityTest, SplitCommandWithDenseQuoting) {
+	expect_linear(
+	    20000,
+	    [](std::size_t n) {
+		    std::string text;
+		    for (std::size_t i = 0; i < n; ++i)
+			    text += i % 3 == 0 ? "a\\ " : i % 3 == 1 ? "'b'\"c\\\"\"" : "\\\n";
+		    return text;
+	    },
+	    [](const std::string &text) { split_command(text); });
+}
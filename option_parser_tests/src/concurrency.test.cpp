@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/option_parser.hpp"
+#include "test_options.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace option_parser;
+using option_parser_test::every_kind_spec;
+using option_parser_test::level;
+
+TEST(ConcurrencyTest, SealedSpecRejectsAdditions) {
+	every_kind_spec s;
+	EXPECT_TRUE(s.options.sealed());
+	EXPECT_THROW(s.options.add_flag("late"), std::logic_error);
+	EXPECT_EQ(s.options.size(), 7u);
+}
+
+// Many threads parse different arguments against one shared spec at the
+// same time. Run under ThreadSanitizer to check for races; without it the
+// test still checks every result.
+TEST(ConcurrencyTest, ManyThreadsParseOneSpec) {
+	const auto shared = std::make_shared<const every_kind_spec>();
+	const every_kind_spec &s = *shared;
+	const unsigned threads = std::max(8u, std::thread::hardware_concurrency());
+	constexpr int iterations = 2000;
+	std::atomic<int> failures{0};
+
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; ++t) {
+		workers.emplace_back([&, t] {
+			for (int i = 0; i < iterations; ++i) {
+				const std::string jobs = "--jobs=" + std::to_string(t * iterations + i);
+				const std::string name = "-nworker" + std::to_string(t);
+				const std::string label = "--label=thread=" + std::to_string(t) + ",iter=" + std::to_string(i);
+				const std::vector<std::string_view> args{"-vv", jobs, name, "-pHIGH", "-Ia", "-Ib", label, "--ratio", "0.25", "file"};
+				const result parsed = parse(s.options, arg_list(args));
+
+				const bool ok = parsed.count(s.verbose) == 2 &&
+				                parsed.get<std::int64_t>(s.jobs) == static_cast<std::int64_t>(t) * iterations + i &&
+				                parsed.get<std::string_view>(s.name) == std::string_view(name).substr(2) &&
+				                parsed.get<level>(s.priority) == level::high &&
+				                parsed.get<string_span>(s.include).size() == 2 &&
+				                parsed.get<flat_string_map>(s.label).find("iter")->value == std::to_string(i) &&
+				                parsed.get<double>(s.ratio) == 0.25 && parsed.positionals().size() == 1;
+				if (!ok)
+					failures.fetch_add(1, std::memory_order_relaxed);
+
+				std::size_t events = 0;
+				visit(s.options, arg_list(args), [&](const option_value &) { ++events; },
+				      [&](std::string_view, std::size_t) { ++events; });
+				if (events != 11)
+					failures.fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+	for (std::thread &worker : workers)
+		worker.join();
+	EXPECT_EQ(failures.load(), 0);
+}
+
+TEST(ConcurrencyTest, ErrorsStayPerThread) {
+	every_kind_spec s;
+	std::atomic<int> errors{0};
+	std::vector<std::thread> workers;
+	for (int t = 0; t < 8; ++t) {
+		workers.emplace_back([&, t] {
+			for (int i = 0; i < 500; ++i) {
+				const std::vector<std::string_view> args{t % 2 == 0 ? "--jobs=x" : "--jobs=3"};
+				try {
+					parse(s.options, arg_list(args)).validate();
+				} catch (const parse_error &e) {
+					if (e.code() == error_code::invalid_value)
+						errors.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+		});
+	}
+	for (std::thread &worker : workers)
+		worker.join();
+	EXPECT_EQ(errors.load(), 4 * 500);
+}
@@ -0,0 +1,311 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/config_watcher.hpp"
+#include "option_parser/diff.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace option_parser;
+using namespace std::chrono_literals;
+
+namespace {
+
+// A fresh directory holding the config files of one test.
+class ConfigWatcherTest : public ::testing::Test {
+protected:
+	ConfigWatcherTest() {
+		std::string pattern = ::testing::TempDir() + "option_parser_watch_XXXXXX";
+		if (!::mkdtemp(pattern.data()))
+			throw std::runtime_error("mkdtemp failed");
+		dir = pattern;
+		jobs = options.add_int("jobs", 'j', 1);
+		name = options.add_string("name", 'n');
+		include = options.add_list("include", 'I');
+		options.seal();
+	}
+
+	~ConfigWatcherTest() override {
+		for (const std::string &file : written)
+			std::remove(file.c_str());
+		::rmdir(dir.c_str());
+	}
+
+	std::string path(const std::string &file) const { return dir + "/" + file; }
+
+	void write(const std::string &file, const std::string &text) {
+		std::ofstream(path(file), std::ios::binary) << text;
+		written.push_back(path(file));
+	}
+
+	// Writes a temporary file and renames it over file, as editors do.
+	void replace(const std::string &file, const std::string &text) {
+		write(file + ".tmp", text);
+		ASSERT_EQ(std::rename(path(file + ".tmp").c_str(), path(file).c_str()), 0);
+	}
+
+	// A loader counting the reads of each file.
+	watch_options counting(std::map<std::string, int> &reads, std::chrono::milliseconds debounce = 20ms) const {
+		watch_options settings;
+		settings.debounce = debounce;
+		settings.load = [&reads](std::string_view file, std::size_t max_size) {
+			++reads[std::string(file.substr(file.rfind('/') + 1))];
+			return read_file(file, max_size);
+		};
+		return settings;
+	}
+
+	std::string dir;
+	std::vector<std::string> written;
+	spec options;
+	option_id jobs, name, include;
+};
+
+} // namespace
+
+TEST_F(ConfigWatcherTest, LaterFilesOverrideEarlierOnes) {
+	write("base.conf", "--jobs=2 --name base -I a");
+	write("site.conf", "# site overrides\n--jobs=8 -I b");
+	config_watcher watcher(options, {path("base.conf"), path("site.conf")});
+	const std::shared_ptr<const config> current = watcher.current();
+	EXPECT_EQ(current->generation(), 1u);
+	EXPECT_EQ(current->values().get<std::int64_t>(jobs), 8);
+	EXPECT_EQ(current->values().get<std::string_view>(name), "base");
+	EXPECT_EQ(current->values().get<string_span>(include).size(), 2u);
+	EXPECT_FALSE(watcher.poll(0ms));
+}
+
+TEST_F(ConfigWatcherTest, FirstLoadThrows) {
+	write("bad.conf", "--jobs=many");
+	EXPECT_THROW(config_watcher(options, {path("bad.conf")}), parse_error);
+	try {
+		config_watcher watcher(options, {path("missing.conf")});
+		FAIL();
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::response_file);
+	}
+}
+
+TEST_F(ConfigWatcherTest, RereadsOnlyChangedFiles) {
+	write("base.conf", "--name base");
+	write("site.conf", "--jobs=2");
+	std::map<std::string, int> reads;
+	config_watcher watcher(options, {path("base.conf"), path("site.conf")}, counting(reads));
+	const std::shared_ptr<const config> first = watcher.current();
+
+	write("site.conf", "--jobs=3");
+	write("unrelated.conf", "--jobs=4");
+	ASSERT_TRUE(watcher.poll(2s));
+	const std::shared_ptr<const config> second = watcher.current();
+	EXPECT_EQ(second->generation(), 2u);
+	EXPECT_EQ(second->values().get<std::int64_t>(jobs), 3);
+	EXPECT_EQ(second->values().get<std::string_view>(name), "base");
+	EXPECT_EQ(reads, (std::map<std::string, int>{{"base.conf", 1}, {"site.conf", 2}}));
+
+	// The old config stays readable while it is held.
+	EXPECT_EQ(first->values().get<std::int64_t>(jobs), 2);
+	EXPECT_EQ(diff(first->values(), second->values()).ids(), std::vector<option_id>{jobs});
+
+	// Rewriting the same bytes publishes nothing.
+	write("site.conf", "--jobs=3");
+	EXPECT_FALSE(watcher.poll(2s));
+	EXPECT_EQ(watcher.current(), second);
+}
+
+TEST_F(ConfigWatcherTest, DebouncesBursts) {
+	write("site.conf", "--jobs=0");
+	std::map<std::string, int> reads;
+	config_watcher watcher(options, {path("site.conf")}, counting(reads, 200ms));
+
+	// Writes every few milliseconds, well inside the debounce period.
+	std::thread writer([&] {
+		for (int i = 1; i <= 20; ++i) {
+			write("site.conf", "--jobs=" + std::to_string(i));
+			std::this_thread::sleep_for(2ms);
+		}
+	});
+	EXPECT_TRUE(watcher.poll(2s));
+	writer.join();
+	while (watcher.poll(0ms)) {
+	}
+	EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), 20);
+	EXPECT_LE(watcher.current()->generation(), 3u);
+	EXPECT_LE(reads["site.conf"], 3);
+}
+
+TEST_F(ConfigWatcherTest, SeesFilesReplacedByRename) {
+	write("site.conf", "--jobs=1");
+	watch_options settings;
+	settings.debounce = 20ms;
+	config_watcher watcher(options, {path("site.conf")}, settings);
+	replace("site.conf", "--jobs=5");
+	ASSERT_TRUE(watcher.poll(2s));
+	EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), 5);
+	replace("site.conf", "--jobs=6");
+	ASSERT_TRUE(watcher.poll(2s));
+	EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), 6);
+}
+
+TEST_F(ConfigWatcherTest, KeepsTheLastGoodConfigOnErrors) {
+	write("site.conf", "--jobs=1");
+	std::vector<std::string> errors;
+	watch_options settings;
+	settings.debounce = 20ms;
+	settings.on_error = [&](std::exception_ptr error) {
+		try {
+			std::rethrow_exception(error);
+		} catch (const parse_error &e) {
+			errors.push_back(e.what());
+		}
+	};
+	config_watcher watcher(options, {path("site.conf")}, settings);
+
+	write("site.conf", "--jobs=lots");
+	EXPECT_FALSE(watcher.poll(2s));
+	write("site.conf", "--jobs=\"unterminated");
+	EXPECT_FALSE(watcher.poll(2s));
+	EXPECT_EQ(errors.size(), 2u);
+	EXPECT_EQ(watcher.current()->generation(), 1u);
+	EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), 1);
+
+	write("site.conf", "--jobs=2");
+	EXPECT_TRUE(watcher.poll(2s));
+	EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), 2);
+}
+
+// A file that failed stays dirty, so a later change to another file does
+// not publish a config built from its last good text.
+TEST_F(ConfigWatcherTest, RereadsFailedFilesWithLaterChanges) {
+	write("a.conf", "--jobs=1");
+	write("b.conf", "--name=b1");
+	int errors = 0;
+	watch_options settings;
+	settings.debounce = 20ms;
+	settings.on_error = [&](std::exception_ptr) { ++errors; };
+	config_watcher watcher(options, {path("a.conf"), path("b.conf")}, settings);
+
+	write("a.conf", "--jobs=lots");
+	EXPECT_FALSE(watcher.poll(2s));
+	write("b.conf", "--name=b2");
+	EXPECT_FALSE(watcher.poll(2s));
+	EXPECT_EQ(errors, 2);
+	EXPECT_EQ(watcher.current()->generation(), 1u);
+
+	write("a.conf", "--jobs=3");
+	ASSERT_TRUE(watcher.poll(2s));
+	EXPECT_EQ(watcher.current()->generation(), 2u);
+	EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), 3);
+	EXPECT_EQ(watcher.current()->values().get<std::string_view>(name), "b2");
+}
+
+// Files are tokenized apart, so a value never comes from the next file,
+// while errors still number the arguments of all the files in order.
+TEST_F(ConfigWatcherTest, TokenizesEachFileOnItsOwn) {
+	write("a.conf", "-I x --name");
+	write("b.conf", "value");
+	EXPECT_THROW(config_watcher(options, {path("a.conf"), path("b.conf")}), parse_error);
+
+	write("a.conf", "-I x --name=a");
+	write("b.conf", "--jobs=lots");
+	try {
+		config_watcher watcher(options, {path("a.conf"), path("b.conf")});
+		FAIL();
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::invalid_value);
+		EXPECT_EQ(e.index(), 3u);
+	}
+}
+
+// Each file fits the limits alone; together they do not, on the first load
+// or on a reload that grows one of them.
+TEST_F(ConfigWatcherTest, AppliesLimitsToTheFilesTogether) {
+	write("a.conf", "-I a -I b");
+	write("b.conf", "-I c -I d");
+	watch_options settings;
+	settings.debounce = 20ms;
+	settings.limits.max_args = 6;
+	try {
+		config_watcher watcher(options, {path("a.conf"), path("b.conf")}, settings);
+		FAIL();
+	} catch (const limit_error &e) {
+		EXPECT_EQ(e.which(), limit_kind::args);
+	}
+
+	settings.limits.max_args = parse_limits::unlimited;
+	settings.limits.max_bytes = 11;
+	try {
+		config_watcher watcher(options, {path("a.conf"), path("b.conf")}, settings);
+		FAIL();
+	} catch (const limit_error &e) {
+		EXPECT_EQ(e.which(), limit_kind::bytes);
+		EXPECT_EQ(e.index(), 7u);
+	}
+
+	settings.limits.max_bytes = 12;
+	config_watcher watcher(options, {path("a.conf"), path("b.conf")}, settings);
+	write("b.conf", "-I c -I d -I e");
+	EXPECT_THROW(watcher.poll(2s), limit_error);
+	EXPECT_EQ(watcher.current()->generation(), 1u);
+}
+
+TEST_F(ConfigWatcherTest, ThrowsReloadErrorsWithoutHandler) {
+	write("site.conf", "--jobs=1");
+	watch_options settings;
+	settings.debounce = 20ms;
+	config_watcher watcher(options, {path("site.conf")}, settings);
+	write("site.conf", "--unknown");
+	EXPECT_THROW(watcher.poll(2s), parse_error);
+	EXPECT_EQ(watcher.current()->generation(), 1u);
+}
+
+// Readers read the current config wait-free on their own threads while the
+// watcher thread publishes new ones; each config they see is whole.
+TEST_F(ConfigWatcherTest, PublishesToReadersOnOtherThreads) {
+	write("site.conf", "--jobs=0 --name=n0");
+	std::atomic<int> published{0};
+	watch_options settings;
+	settings.debounce = 5ms;
+	settings.on_publish = [&](const std::shared_ptr<const config> &before, const std::shared_ptr<const config> &after) {
+		if (after->generation() == before->generation() + 1)
+			published.fetch_add(1);
+	};
+	config_watcher watcher(options, {path("site.conf")}, settings);
+	watcher.start();
+	EXPECT_THROW(watcher.start(), std::logic_error);
+
+	std::atomic<bool> done{false};
+	std::atomic<int> torn{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&] {
+			const published_config::reader reader(watcher.published());
+			while (!done.load()) {
+				const published_config::guard current = reader.read();
+				const std::int64_t value = current->values().get<std::int64_t>(jobs);
+				if (current->values().get<std::string_view>(name) != "n" + std::to_string(value))
+					torn.fetch_add(1);
+			}
+		});
+	}
+	for (int i = 1; i <= 5; ++i) {
+		replace("site.conf", "--jobs=" + std::to_string(i) + " --name=n" + std::to_string(i));
+		for (int wait = 0; wait < 200 && watcher.current()->values().get<std::int64_t>(jobs) != i; ++wait)
+			std::this_thread::sleep_for(10ms);
+		EXPECT_EQ(watcher.current()->values().get<std::int64_t>(jobs), i);
+	}
+	done.store(true);
+	for (std::thread &reader : readers)
+		reader.join();
+	watcher.stop();
+	EXPECT_EQ(torn.load(), 0);
+	EXPECT_EQ(published.load(), static_cast<int>(watcher.current()->generation()) - 1);
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/diff.hpp"
+#include "option_parser/option_parser.hpp"
+#include "test_options.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+using option_parser_test::level;
+using option_parser_test::levels;
+
+namespace {
+
+class DiffTest : public ::testing::Test {
+protected:
+	DiffTest() {
+		verbose = options.add_flag("verbose", 'v');
+		name = options.add_string("name", 'n', "worker");
+		jobs = options.add_int("db.pool.size", 'j', 4);
+		ratio = options.add_double("db.pool.ratio", '\0', 0.5);
+		mode = options.add_choice("mode", 'm', levels, level::low);
+		include = options.add_list("include", 'I');
+		labels = options.add_map("labels", 'l', ',');
+		host = options.add_string("db.host");
+	}
+
+	result parse_args(const std::vector<std::string_view> &args) const { return parse(options, arg_list(args)); }
+
+	std::vector<option_id> changed(const std::vector<std::string_view> &before,
+	                               const std::vector<std::string_view> &after) const {
+		return diff(parse_args(before), parse_args(after)).ids();
+	}
+
+	spec options;
+	option_id verbose, name, jobs, ratio, mode, include, labels, host;
+};
+
+} // namespace
+
+TEST_F(DiffTest, ComparesValuesNotSpelling) {
+	using ids = std::vector<option_id>;
+	EXPECT_EQ(changed({}, {}), ids{});
+	EXPECT_EQ(changed({}, {"-n", "worker", "-j4", "--db.pool.ratio=0.50", "--mode=low"}), ids{});
+	EXPECT_EQ(changed({"-j", "4"}, {"--db.pool.size=04"}), ids{});
+	EXPECT_EQ(changed({"-la=1,b=2"}, {"-lb=2", "-la=1"}), ids{}) << "map order does not matter";
+	EXPECT_EQ(changed({"--db.pool.ratio=nan"}, {"--db.pool.ratio=nan"}), ids{});
+
+	EXPECT_EQ(changed({"-v"}, {"-vv"}), ids{verbose});
+	EXPECT_EQ(changed({}, {"-n", "api", "--mode=high"}), (ids{name, mode}));
+	EXPECT_EQ(changed({"-Ia", "-Ib"}, {"-Ib", "-Ia"}), ids{include}) << "list order does";
+	EXPECT_EQ(changed({"-Ia"}, {"-Ia", "-Ia"}), ids{include});
+	EXPECT_EQ(changed({"-la=1"}, {"-la=2"}), ids{labels});
+	EXPECT_EQ(changed({"-la=1"}, {"-la=1,b=1"}), ids{labels});
+	EXPECT_EQ(changed({"--db.host=a", "-j8"}, {"--db.host=b", "-j8", "--db.pool.ratio=1"}), (ids{ratio, host}));
+
+	const change_set changes = diff(parse_args({"-v"}), parse_args({"-I", "x"}));
+	EXPECT_TRUE(changes.contains(verbose));
+	EXPECT_TRUE(changes.contains(include));
+	EXPECT_FALSE(changes.contains(name));
+	EXPECT_EQ(changes.size(), 2u);
+}
+
+TEST_F(DiffTest, ConvertsAsReadingWould) {
+	const result bad = parse_args({"-j", "lots"});
+	EXPECT_THROW(diff(parse_args({}), bad), parse_error);
+
+	spec other = options;
+	EXPECT_THROW(diff(parse_args({}), parse(other, arg_list(std::vector<std::string_view>{}))), std::invalid_argument);
+}
+
+TEST_F(DiffTest, NotifiesSubscribersOfWhatChanged) {
+	change_notifier notifier;
+	std::vector<std::string> calls;
+	notifier.subscribe(name, [&](const result &current, const change_set &) {
+		calls.push_back("name=" + std::string(current.get<std::string_view>(name)));
+	});
+	notifier.subscribe(*options.group("db"), [&](const result &, const change_set &changes) {
+		calls.push_back("db x" + std::to_string(changes.size()));
+	});
+	const auto lists = notifier.subscribe({include, labels, include}, [&](const result &, const change_set &) {
+		calls.push_back("lists");
+	});
+
+	const result first = parse_args({"-n", "a"});
+	const result second = parse_args({"-n", "b", "-j8", "--db.host=x", "-Ix", "-la=1"});
+	const result third = parse_args({"-n", "b", "-j8", "--db.host=x", "-v"});
+
+	EXPECT_EQ(notifier.publish(first, second).size(), 5u);
+	EXPECT_EQ(calls, (std::vector<std::string>{"name=b", "db x5", "lists"}));
+
+	calls.clear();
+	notifier.unsubscribe(lists);
+	notifier.unsubscribe(lists);
+	EXPECT_EQ(notifier.publish(second, third).size(), 3u);
+	EXPECT_TRUE(calls.empty()) << "only -v and the lists changed";
+
+	EXPECT_TRUE(notifier.publish(third, third).empty());
+	EXPECT_TRUE(calls.empty());
+}
+
+TEST_F(DiffTest, CallbacksMaySubscribeAndUnsubscribe) {
+	change_notifier notifier;
+	int once_calls = 0;
+	int later_calls = 0;
+	change_notifier::subscription once = 0;
+	once = notifier.subscribe(verbose, [&](const result &, const change_set &) {
+		++once_calls;
+		notifier.unsubscribe(once);
+		notifier.subscribe(verbose, [&](const result &, const change_set &) { ++later_calls; });
+	});
+
+	const result quiet = parse_args({});
+	const result loud = parse_args({"-v"});
+	notifier.publish(quiet, loud);
+	EXPECT_EQ(once_calls, 1);
+	EXPECT_EQ(later_calls, 0);
+	notifier.publish(loud, quiet);
+	EXPECT_EQ(once_calls, 1);
+	EXPECT_EQ(later_calls, 1);
+}
+
+// A nested publish would end the outer one's hold on dropped callbacks
+// while they may still be running, so it is refused.
+TEST_F(DiffTest, CallbacksMayNotPublish) {
+	change_notifier notifier;
+	const result quiet = parse_args({});
+	const result loud = parse_args({"-v"});
+	int calls = 0;
+	change_notifier::subscription self = 0;
+	self = notifier.subscribe(verbose, [&](const result &, const change_set &) {
+		++calls;
+		notifier.unsubscribe(self);
+		EXPECT_THROW(notifier.publish(loud, quiet), std::logic_error);
+	});
+	int others = 0;
+	notifier.subscribe(verbose, [&](const result &, const change_set &) { ++others; });
+
+	notifier.publish(quiet, loud);
+	EXPECT_EQ(calls, 1);
+	EXPECT_EQ(others, 1);
+	notifier.publish(loud, quiet);
+	EXPECT_EQ(calls, 1);
+	EXPECT_EQ(others, 2);
+}
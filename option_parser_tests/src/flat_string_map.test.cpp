@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/flat_string_map.hpp"
+
+#include <string>
+#include <vector>
+
+using option_parser::flat_string_map;
+
+TEST(FlatStringMapTest, InsertsAndFinds) {
+	flat_string_map map;
+	EXPECT_EQ(map.find("missing"), nullptr);
+
+	EXPECT_TRUE(map.insert("team", "infra").second);
+	EXPECT_TRUE(map.insert("tier", "gold").second);
+	const auto [existing, inserted] = map.insert("team", "other");
+	EXPECT_FALSE(inserted);
+	EXPECT_EQ(existing->value, "infra");
+
+	ASSERT_NE(map.find("tier"), nullptr);
+	EXPECT_EQ(map.find("tier")->value, "gold");
+	EXPECT_TRUE(map.contains("team"));
+	EXPECT_FALSE(map.contains("tea"));
+	EXPECT_EQ(map.size(), 2u);
+}
+
+TEST(FlatStringMapTest, IteratesInInsertionOrderAcrossRehashes) {
+	std::vector<std::string> keys;
+	for (int i = 0; i < 5000; ++i)
+		keys.push_back("label-" + std::to_string(i * 31 % 5000));
+
+	flat_string_map map;
+	for (const std::string &key : keys)
+		map.insert(key, key);
+	ASSERT_EQ(map.size(), keys.size());
+
+	std::size_t i = 0;
+	for (const auto &entry : map) {
+		EXPECT_EQ(entry.key, keys[i]);
+		EXPECT_EQ(entry.value, keys[i]);
+		++i;
+	}
+	for (const std::string &key : keys)
+		EXPECT_EQ(map.find(key)->value, key);
+}
+
+TEST(FlatStringMapTest, ReserveKeepsEntriesInPlace) {
+	std::vector<std::string> keys;
+	for (int i = 1; i < 100; ++i)
+		keys.push_back("k" + std::to_string(i));
+
+	flat_string_map map;
+	map.reserve(100);
+	const flat_string_map::entry *first = map.insert("k0", "v").first;
+	for (const std::string &key : keys)
+		map.insert(key, "v");
+	EXPECT_EQ(map.find("k0"), first);
+	EXPECT_EQ(map.size(), 100u);
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include "server_options.hpp"
+
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+using args = std::vector<std::string_view>;
+
+template <typename Fn>
+std::optional<parse_error> error_of(Fn &&fn) {
+	try {
+		fn();
+	} catch (const parse_error &e) {
+		return e;
+	}
+	return std::nullopt;
+}
+
+void expect_map_eq(const flat_string_map &expected, const flat_string_map &actual) {
+	ASSERT_EQ(expected.size(), actual.size());
+	for (const flat_string_map::entry &entry : expected) {
+		const flat_string_map::entry *found = actual.find(entry.key);
+		ASSERT_NE(found, nullptr) << entry.key;
+		EXPECT_EQ(found->value, entry.value) << entry.key;
+	}
+}
+
+void expect_list_eq(string_span expected, const std::vector<std::string_view> &actual) {
+	EXPECT_EQ(std::vector<std::string_view>(expected.begin(), expected.end()), actual);
+}
+
+// Parses list with both engines and expects the same values or the same error.
+void expect_same(const spec &options, const args &list) {
+	SCOPED_TRACE(::testing::PrintToString(list));
+	std::optional<result> runtime;
+	const std::optional<parse_error> runtime_error = error_of([&] {
+		runtime.emplace(parse(options, arg_list(list)));
+		runtime->validate();
+	});
+	std::optional<demo::server_options> generated;
+	const std::optional<parse_error> generated_error =
+	    error_of([&] { generated.emplace(demo::parse_server_options(arg_list(list))); });
+
+	ASSERT_EQ(runtime_error.has_value(), generated_error.has_value())
+	    << (runtime_error ? runtime_error->what() : generated_error->what());
+	if (runtime_error) {
+		EXPECT_EQ(runtime_error->code(), generated_error->code());
+		EXPECT_EQ(runtime_error->index(), generated_error->index());
+		EXPECT_STREQ(runtime_error->what(), generated_error->what());
+		return;
+	}
+
+	const result &r = *runtime;
+	const demo::server_options &g = *generated;
+	EXPECT_EQ(r.get<bool>("verbose"), g.verbose);
+	EXPECT_EQ(r.get<bool>("dry-run"), g.dry_run);
+	EXPECT_EQ(r.get<std::int64_t>("jobs"), g.jobs);
+	EXPECT_EQ(r.get<std::int64_t>("port"), g.port);
+	EXPECT_EQ(r.get<double>("ratio"), g.ratio);
+	EXPECT_EQ(r.get<std::string_view>("name"), g.name);
+	EXPECT_EQ(r.get<std::string_view>("host"), g.host);
+	EXPECT_EQ(r.get<std::string_view>("version"), g.version);
+	EXPECT_EQ(r.get<demo::level_choice>("level"), g.level);
+	EXPECT_EQ(r.get<demo::format_choice>("format"), g.format);
+	expect_list_eq(r.get<string_span>("include"), g.include);
+	expect_list_eq(r.get<string_span>("exclude"), g.exclude);
+	expect_map_eq(r.get<flat_string_map>("label"), g.label);
+	expect_map_eq(r.get<flat_string_map>("env"), g.env);
+	EXPECT_EQ(r.get<bool>("jitter"), g.jitter);
+	EXPECT_EQ(r.get<bool>("journal"), g.journal);
+	EXPECT_EQ(r.get<std::string_view>("größe"), g.size);
+	EXPECT_EQ(r.positionals(), g.positionals);
+	ASSERT_EQ(r.diagnostics().size(), g.diagnostics.size());
+	for (std::size_t i = 0; i < g.diagnostics.size(); ++i) {
+		EXPECT_EQ(r.diagnostics()[i].index, g.diagnostics[i].index);
+		EXPECT_EQ(r.diagnostics()[i].id, g.diagnostics[i].id);
+		EXPECT_EQ(r.diagnostics()[i].message, g.diagnostics[i].message);
+	}
+}
+
+} // namespace
+
+TEST(GeneratedParserTest, FillsTypedFields) {
+	const args list{"-vj8", "--ratio=0.25", "-Hweb-1", "-L", "h", "--format=TEXT", "-I", "a", "--inc=b",
+	                "-la=1,b=2",  "-eK=V",      "--dry-run", "in", "--", "-x"};
+	const demo::server_options options = demo::parse_server_options(arg_list(list));
+	EXPECT_TRUE(options.verbose);
+	EXPECT_TRUE(options.dry_run);
+	EXPECT_EQ(options.jobs, 8);
+	EXPECT_EQ(options.port, 8080);
+	EXPECT_EQ(options.ratio, 0.25);
+	EXPECT_EQ(options.name, "worker");
+	EXPECT_EQ(options.host, "web-1");
+	EXPECT_EQ(options.version, "v1");
+	EXPECT_EQ(options.level, demo::level_choice::high);
+	EXPECT_EQ(options.format, demo::format_choice::text);
+	EXPECT_EQ(options.include, (std::vector<std::string_view>{"a", "b"}));
+	EXPECT_EQ(options.label.size(), 2u);
+	EXPECT_EQ(options.env.find("K")->value, "V");
+	EXPECT_EQ(options.positionals, (std::vector<std::string_view>{"in", "-x"}));
+	EXPECT_TRUE(options.diagnostics.empty());
+}
+
+TEST(GeneratedParserTest, ReportsDeprecatedAliases) {
+	const demo::server_options options = demo::parse_server_options(arg_list(args{"--threads=2", "-T", "3"}));
+	EXPECT_EQ(options.jobs, 3);
+	ASSERT_EQ(options.diagnostics.size(), 2u);
+	EXPECT_EQ(options.diagnostics[0].index, 0u);
+	EXPECT_EQ(options.diagnostics[1].index, 1u);
+}
+
+TEST(GeneratedParserTest, SpecMatchesDeclarations) {
+	const spec options = demo::server_options_spec();
+	EXPECT_EQ(options.size(), 17u);
+	EXPECT_TRUE(options.requires_utf8());
+	EXPECT_TRUE(options.positionals_accept_bytes());
+	EXPECT_TRUE(options.accepts_bytes(options.id("name")));
+	EXPECT_TRUE(options.accepts_bytes(options.id("exclude")));
+	EXPECT_FALSE(options.accepts_bytes(options.id("host")));
+	EXPECT_EQ(options.id("jobs"), 2u);
+	EXPECT_EQ(options.find_long("threads"), options.find_long("jobs"));
+	EXPECT_EQ(options.def(options.id("level")).match, choice_match::prefix);
+}
+
+TEST(GeneratedParserTest, MatchesRuntimeParser) {
+	const spec options = demo::server_options_spec();
+	const std::vector<args> cases{
+	    {},
+	    {"--jobs=x", "--jobs=2"},
+	    {"--jobs=2", "--jobs=x"},
+	    {"--port=x", "--ratio=y"},
+	    {"--ratio=y", "--port=x"},
+	    {"-l", "a=1,a=2", "--unknown"},
+	    {"-l", "a=1,a=2", "--jobs=x"},
+	    {"--level=", "--level=m"},
+	    {"--format=Default", "-Lx"},
+	    {"--host=UPPER", "--version=v1.2.3"},
+	    {"--version=1"},
+	    {"--dry-run=yes"},
+	    {"-j"},
+	    {"--env"},
+	    {"-vT", "5", "--loud"},
+	    {"--jo"},
+	    {"--jitter", "--journal", "-"},
+	    {"--größe=XL", "ünïcode"},
+	    {"--name", "\xc3", "--unknown"},
+	    {"--jobs=x", "-n", "\xed\xa0\x80"},
+	    {"-Xa\xff", "-vX", "\xfe", "-H\xff"},
+	    {"--exclude=\xc3", "--include=\xc3"},
+	    {"--exclude\xff=x"},
+	    {"-vn\x80", "\x80", "--", "-\x80"},
+	};
+	for (const args &list : cases)
+		expect_same(options, list);
+}
+
+// Random argument vectors drawn from words that exercise every option kind,
+// name form and error, compared between the generated and runtime parsers.
+TEST(GeneratedParserTest, MatchesRuntimeParserOnRandomArguments) {
+	const spec options = demo::server_options_spec();
+	const std::vector<std::string_view> words{
+	    "-v",       "--verbose",   "--loud",       "--dry-run",    "--dry-run=x", "-j",         "8",
+	    "-j8",      "--jobs=x",    "--threads=3",  "-T",           "-vj",         "--port",     "65536",
+	    "-p1e3",    "--ratio=1.5", "--ratio=abc",  "--ratio",      "-n",          "w",          "-H",
+	    "Bad_Host", "-Hweb-1",     "--version=v1.2", "--version=2", "-L",         "h",          "-Lm",
+	    "--level=x", "--level=",   "--format=JSON", "--format=Def", "--format=default", "-I", "inc",
+	    "--inc=x",  "-X",          "e",            "-l",           "a=1,b=2",     "-la=3",      "--label=noeq",
+	    "-l=,",     "-e",          "K=V",          "-eK=W",        "--env=K",     "--jitter",   "--journal",
+	    "--jo",     "--unknown",   "-Z",           "--",           "pos",         "-",          "-vx",
+	    "--größe=x", "--größe",    "ünïcode",      "\xc3",         "--name=\xff", "\xed\xa0\x80", "-\xc3\xa9",
+	    "-X\xff",   "-vX",        "--exclude=\xfe", "-H\xff",     "--inc=\xff",
+	};
+	std::mt19937 random(41);
+	std::uniform_int_distribution<std::size_t> pick(0, words.size() - 1);
+	std::uniform_int_distribution<std::size_t> length(0, 8);
+	for (int i = 0; i < 20000; ++i) {
+		args list(length(random));
+		for (std::string_view &word : list)
+			word = words[pick(random)];
+		expect_same(options, list);
+		if (HasFailure())
+			return;
+	}
+}
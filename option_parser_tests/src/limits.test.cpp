@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/response_file.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// Bytes requested from operator new on this thread while an
+// allocation_counter is alive.
+thread_local std::size_t *allocated = nullptr;
+
+struct allocation_counter {
+	std::size_t bytes = 0;
+
+	allocation_counter() { allocated = &bytes; }
+	~allocation_counter() { allocated = nullptr; }
+};
+
+// Runs fn, which must throw limit_error, and returns the error along with
+// the bytes allocated before it was thrown.
+template <typename Fn>
+std::pair<limit_kind, std::size_t> trip(Fn &&fn, std::size_t expected_index) {
+	allocation_counter counter;
+	try {
+		fn();
+	} catch (const limit_error &e) {
+		allocated = nullptr;
+		EXPECT_EQ(e.code(), error_code::limit_exceeded);
+		EXPECT_EQ(e.index(), expected_index);
+		return {e.which(), counter.bytes};
+	}
+	allocated = nullptr;
+	ADD_FAILURE() << "expected a limit_error";
+	return {limit_kind::args, counter.bytes};
+}
+
+// Enough for the exception message, far below what any limit guards.
+constexpr std::size_t small = 1024;
+
+} // namespace
+
+// Replaced for the whole test binary; counting is off unless a test asks.
+void *operator new(std::size_t size) {
+	if (allocated != nullptr)
+		*allocated += size;
+	if (void *p = std::malloc(size != 0 ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+	std::free(p);
+}
+
+TEST(LimitsTest, ArgumentCountTripsBeforeAllocating) {
+	spec options;
+	options.add_list("include", 'I');
+	const std::vector<std::string_view> args(100000, "-Ifoo");
+	parse_limits limits;
+	limits.max_args = 100;
+
+	const auto [which, bytes] = trip([&] { parse(options, arg_list(args), limits); }, 100);
+	EXPECT_EQ(which, limit_kind::args);
+	EXPECT_LT(bytes, small);
+
+	limits.max_args = args.size();
+	EXPECT_NO_THROW(parse(options, arg_list(args), limits));
+}
+
+TEST(LimitsTest, TotalBytesTripBeforeAllocating) {
+	spec options;
+	options.add_string("name", 'n');
+	const std::string big(1 << 20, 'x');
+	const std::vector<std::string_view> args{"--name", big, big, big};
+	parse_limits limits;
+	limits.max_bytes = 2 << 20;
+
+	const auto [which, bytes] = trip([&] { parse(options, arg_list(args), limits); }, 2);
+	EXPECT_EQ(which, limit_kind::bytes);
+	EXPECT_LT(bytes, small);
+}
+
+TEST(LimitsTest, ListLengthTripsBeforeValuesAreStored) {
+	spec options;
+	const option_id include = options.add_list("include", 'I');
+	options.add_flag("verbose", 'v');
+	std::vector<std::string_view> args{"-v"};
+	args.insert(args.end(), 100000, "-Ifoo");
+	parse_limits limits;
+	limits.max_values = 10;
+
+	// Only the token list is allocated; the list buffer never is.
+	const auto [which, bytes] = trip([&] { parse(options, arg_list(args), limits); }, 11);
+	EXPECT_EQ(which, limit_kind::values);
+	EXPECT_LT(bytes, args.size() * sizeof(token) + small);
+
+	limits.max_values = 100000;
+	EXPECT_EQ(parse(options, arg_list(args), limits).get<string_span>(include).size(), 100000u);
+}
+
+TEST(LimitsTest, MapPairsCountAgainstTheValueLimit) {
+	spec options;
+	options.add_map("label", 'l', ',');
+	std::string pairs = "k0=v";
+	for (int i = 1; i < 10000; ++i)
+		pairs += ",k" + std::to_string(i) + "=v";
+	const std::vector<std::string_view> args{"-l", "a=b", "--label", pairs};
+	parse_limits limits;
+	limits.max_values = 100;
+
+	const auto [which, bytes] = trip([&] { parse(options, arg_list(args), limits); }, 2);
+	EXPECT_EQ(which, limit_kind::values);
+	EXPECT_LT(bytes, small);
+}
+
+TEST(LimitsTest, ResponseDepthStopsLoading) {
+	std::size_t loads = 0;
+	const file_loader load = [&](std::string_view path, std::size_t) -> std::optional<std::string> {
+		++loads;
+		return "x @" + std::string(path) + "x";
+	};
+	const std::vector<std::string_view> args{"a", "@f"};
+	parse_limits limits;
+	limits.max_response_depth = 3;
+
+	const auto [which, bytes] = trip([&] { expand_response_files(arg_list(args), load, limits); }, 1);
+	EXPECT_EQ(which, limit_kind::response_depth);
+	EXPECT_EQ(loads, 3u);
+}
+
+TEST(LimitsTest, ResponseBytesBoundWhatIsRead) {
+	const std::string path = ::testing::TempDir() + "option_parser_limits.txt";
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << std::string(1 << 20, 'x');
+	}
+	const std::string arg = "@" + path;
+	const std::vector<std::string_view> args{"-v", arg};
+	parse_limits limits;
+	limits.max_response_bytes = 1000;
+
+	// The file is read in small chunks and only one byte past the limit.
+	const auto [which, bytes] = trip([&] { expand_response_files(arg_list(args), read_file, limits); }, 1);
+	EXPECT_EQ(which, limit_kind::response_bytes);
+	EXPECT_LT(bytes, std::size_t{64} << 10);
+	EXPECT_EQ(read_file(path, 1000)->size(), 1001u);
+	EXPECT_EQ(read_file(path)->size(), std::size_t{1} << 20);
+	std::remove(path.c_str());
+}
+
+TEST(LimitsTest, ExpandedArgumentsRespectParseLimits) {
+	const file_loader load = [](std::string_view, std::size_t) -> std::optional<std::string> {
+		return "one two three four five";
+	};
+	const std::vector<std::string_view> args{"a", "b", "@words"};
+	parse_limits limits;
+	limits.max_args = 6;
+	EXPECT_EQ(trip([&] { expand_response_files(arg_list(args), load, limits); }, 2).first, limit_kind::args);
+
+	limits.max_args = parse_limits::unlimited;
+	limits.max_bytes = 10;
+	EXPECT_EQ(trip([&] { expand_response_files(arg_list(args), load, limits); }, 2).first, limit_kind::bytes);
+
+	limits.max_bytes = 21;
+	EXPECT_EQ(expand_response_files(arg_list(args), load, limits).size(), 7u);
+}
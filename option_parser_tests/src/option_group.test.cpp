@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/option_parser.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+std::vector<std::string_view> child_names(option_group group) {
+	std::vector<std::string_view> names;
+	for (const option_group child : group)
+		names.push_back(child.name());
+	return names;
+}
+
+// A nested struct bound to the `db` group, with ids looked up once.
+struct db_config {
+	std::string_view host;
+	struct {
+		std::int64_t size = 0;
+		double timeout = 0.0;
+	} pool;
+};
+
+struct db_binding {
+	option_id host;
+	option_id pool_size;
+	option_id pool_timeout;
+
+	explicit db_binding(option_group db)
+	    : host(*db.child("host")->option()), pool_size(*db.find("pool.size")->option()),
+	      pool_timeout(*db.find("pool.timeout")->option()) {}
+
+	db_config read(const result &parsed) const {
+		db_config config;
+		config.host = parsed.get<std::string_view>(host);
+		config.pool.size = parsed.get<std::int64_t>(pool_size);
+		config.pool.timeout = parsed.get<double>(pool_timeout);
+		return config;
+	}
+};
+
+} // namespace
+
+TEST(OptionGroupTest, DottedNamesFormATree) {
+	spec options;
+	const option_id verbose = options.add_flag("verbose", 'v');
+	const option_id pool_size = options.add_int("db.pool.size", '\0', 4);
+	const option_id host = options.add_string("db.host", '\0', "localhost");
+	const option_id pool = options.add_flag("db.pool");
+	const option_id timeout = options.add_double("db.pool.timeout", '\0', 1.5);
+	const option_id ttl = options.add_int("cache.ttl");
+	options.add_alias(pool_size, "pool-size");
+
+	EXPECT_EQ(child_names(options.groups()), (std::vector<std::string_view>{"cache", "db", "verbose"}));
+	EXPECT_EQ(options.groups().name(), "");
+	EXPECT_FALSE(options.groups().option());
+
+	const std::optional<option_group> db = options.group("db");
+	ASSERT_TRUE(db);
+	EXPECT_FALSE(db->option());
+	EXPECT_EQ(child_names(*db), (std::vector<std::string_view>{"host", "pool"}));
+	EXPECT_EQ(db->child("host")->option(), host);
+	EXPECT_EQ(db->child("pool")->option(), pool);
+	EXPECT_EQ(child_names(*db->child("pool")), (std::vector<std::string_view>{"size", "timeout"}));
+	EXPECT_EQ(options.group("db.pool.timeout")->option(), timeout);
+	EXPECT_EQ(options.group("cache.ttl")->option(), ttl);
+	EXPECT_EQ(options.group("verbose")->option(), verbose);
+	EXPECT_EQ(options.group("")->option(), std::nullopt);
+
+	EXPECT_FALSE(options.group("db.pool.size.x"));
+	EXPECT_FALSE(options.group("db.nope"));
+	EXPECT_FALSE(options.group("pool-size")) << "aliases are not in the tree";
+
+	std::vector<option_id> under_db;
+	db->for_each_option([&](option_id id) { under_db.push_back(id); });
+	EXPECT_EQ(under_db, (std::vector<option_id>{host, pool, pool_size, timeout}));
+
+	// Copies carry their own tree.
+	const spec copy = options;
+	EXPECT_EQ(copy.group("db.pool.size")->option(), pool_size);
+}
+
+TEST(OptionGroupTest, BindsGroupsToNestedStructs) {
+	spec options;
+	options.add_string("db.host", '\0', "localhost");
+	options.add_int("db.pool.size", '\0', 4);
+	options.add_double("db.pool.timeout", '\0', 1.5);
+	options.add_int("cache.ttl");
+
+	const db_binding bind(*options.group("db"));
+	const std::vector<std::string_view> args{"--db.pool.size=8", "--db.host", "db-1", "--cache.ttl=60"};
+	const db_config config = bind.read(parse(options, arg_list(args)));
+	EXPECT_EQ(config.host, "db-1");
+	EXPECT_EQ(config.pool.size, 8);
+	EXPECT_EQ(config.pool.timeout, 1.5);
+}
+
+TEST(OptionGroupTest, ManyKnobsEnumeratePerGroup) {
+	spec options;
+	for (char service = 'a'; service <= 'z'; ++service)
+		for (int knob = 0; knob < 20; ++knob)
+			options.add_int(std::string("svc-") + service + ".tuning.knob" + std::to_string(knob));
+	options.add_flag("svc-q");
+
+	std::size_t groups = 0;
+	for (const option_group service : options.groups()) {
+		++groups;
+		std::size_t knobs = 0;
+		service.for_each_option([&](option_id id) {
+			EXPECT_EQ(options.def(id).long_name.compare(0, service.name().size(), service.name()), 0);
+			++knobs;
+		});
+		EXPECT_EQ(knobs, service.name() == "svc-q" ? 21u : 20u) << service.name();
+	}
+	EXPECT_EQ(groups, 26u);
+	EXPECT_EQ(options.group("svc-q")->option(), options.id("svc-q"));
+	EXPECT_EQ(options.group("svc-m.tuning.knob7")->option(), options.id("svc-m.tuning.knob7"));
+}
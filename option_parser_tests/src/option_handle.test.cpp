@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/option_parser.hpp"
+#include "test_options.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace option_parser;
+using option_parser_test::level;
+using option_parser_test::levels;
+
+namespace {
+
+enum class color { red, blue };
+
+// Whether result::get<T> compiles for a handle of type Handle; T = void
+// reads as the handle's own type.
+template <typename T, typename Handle, typename = void>
+struct can_get : std::false_type {};
+template <typename T, typename Handle>
+struct can_get<T, Handle, std::void_t<decltype(std::declval<const result &>().get<T>(std::declval<Handle>()))>>
+    : std::true_type {};
+
+template <typename T, typename Handle>
+constexpr bool can_get_v = can_get<T, Handle>::value;
+
+// Handles carry the type add_* fixed.
+static_assert(std::is_same_v<decltype(std::declval<spec &>().add_int("")), option_handle<std::int64_t>>);
+static_assert(std::is_same_v<decltype(std::declval<spec &>().add_flag("")), option_handle<bool>>);
+static_assert(std::is_same_v<decltype(std::declval<spec &>().add_list("")), option_handle<string_span>>);
+static_assert(std::is_same_v<decltype(std::declval<spec &>().add_choice("", 'x', levels, level::low)),
+                             option_handle<level>>);
+
+// Reading as the declared type compiles.
+static_assert(can_get_v<void, option_handle<std::int64_t>>);
+static_assert(can_get_v<std::int64_t, option_handle<std::int64_t>>);
+static_assert(can_get_v<double, option_handle<double>>);
+static_assert(can_get_v<level, option_handle<level>>);
+static_assert(can_get_v<flat_string_map, option_handle<flat_string_map>>);
+static_assert(std::is_same_v<decltype(std::declval<const result &>().get(std::declval<option_handle<std::int64_t>>())),
+                             std::int64_t>);
+static_assert(std::is_same_v<decltype(std::declval<const result &>().get(std::declval<option_handle<flat_string_map>>())),
+                             const flat_string_map &>);
+
+// Reading as anything else does not, narrower numbers included.
+static_assert(!can_get_v<int, option_handle<std::int64_t>>);
+static_assert(!can_get_v<std::uint16_t, option_handle<std::int64_t>>);
+static_assert(!can_get_v<std::uint64_t, option_handle<std::int64_t>>);
+static_assert(!can_get_v<float, option_handle<double>>);
+static_assert(!can_get_v<double, option_handle<std::int64_t>>);
+static_assert(!can_get_v<std::int64_t, option_handle<double>>);
+static_assert(!can_get_v<bool, option_handle<std::int64_t>>);
+static_assert(!can_get_v<std::int64_t, option_handle<bool>>);
+static_assert(!can_get_v<std::string_view, option_handle<string_span>>);
+static_assert(!can_get_v<string_span, option_handle<std::string_view>>);
+static_assert(!can_get_v<color, option_handle<level>>);
+static_assert(!can_get_v<std::int64_t, option_handle<level>>);
+
+// Handles convert to option_id and to nothing else.
+static_assert(std::is_convertible_v<option_handle<double>, option_id>);
+static_assert(!std::is_convertible_v<option_handle<std::int64_t>, option_handle<double>>);
+static_assert(!std::is_convertible_v<option_handle<level>, option_handle<color>>);
+static_assert(!std::is_convertible_v<option_handle<std::string_view>, option_handle<string_span>>);
+static_assert(!std::is_constructible_v<option_handle<std::int64_t>, option_id>);
+
+class OptionHandleTest : public ::testing::Test {
+protected:
+	spec options;
+	option_handle<bool> verbose = options.add_flag("verbose", 'v');
+	option_handle<std::int64_t> batch = options.add_int("batch-size", 'b', 64);
+	option_handle<double> ratio = options.add_double("ratio", 'r', 0.5);
+	option_handle<std::string_view> host = options.add_pattern("host", 'H', "[a-z]+", "local");
+	option_handle<level> priority = options.add_choice("priority", 'p', levels, level::low);
+	option_handle<string_span> include = options.add_list("include", 'I');
+	option_handle<flat_string_map> labels = options.add_map("labels", 'l', ',');
+
+	result parse_args(std::vector<std::string_view> args) const { return parse(options, arg_list(args)); }
+};
+
+} // namespace
+
+TEST_F(OptionHandleTest, ReadsLikeGetById) {
+	const result parsed = parse_args({"-vv", "-b", "256", "-r0.25", "-Hweb", "-phigh", "-Ia", "-Ib", "-la=1,b=2"});
+	EXPECT_TRUE(parsed.get(verbose));
+	EXPECT_EQ(parsed.count(verbose), 2u);
+	EXPECT_EQ(parsed.get(batch), 256);
+	EXPECT_EQ(parsed.get<std::int64_t>(batch), 256);
+	EXPECT_EQ(parsed.get(ratio), 0.25);
+	EXPECT_EQ(parsed.get(host), "web");
+	EXPECT_EQ(parsed.get(priority), level::high);
+	EXPECT_EQ(parsed.get(include).size(), 2u);
+	EXPECT_EQ(parsed.get(labels).find("b")->value, "2");
+
+	EXPECT_EQ(parsed.get(batch), parsed.get<std::int64_t>(batch.id()));
+	EXPECT_EQ(parsed.get(host), parsed.get<std::string_view>("host"));
+
+	const result defaults = parse_args({});
+	EXPECT_FALSE(defaults.get(verbose));
+	EXPECT_EQ(defaults.get(batch), 64);
+	EXPECT_EQ(defaults.get(host), "local");
+	EXPECT_EQ(defaults.get(priority), level::low);
+	EXPECT_TRUE(defaults.get(include).empty());
+}
+
+TEST_F(OptionHandleTest, ConvertsOnFirstRead) {
+	const result parsed = parse_args({"-b", "lots", "-H", "UPPER"});
+	EXPECT_THROW(parsed.get(batch), parse_error);
+	EXPECT_THROW(parsed.get(host), parse_error);
+	EXPECT_EQ(parsed.get(ratio), 0.5);
+}
+
+TEST_F(OptionHandleTest, ResolvedByName) {
+	const option_handle<std::int64_t> by_name = options.handle<std::int64_t>("batch-size");
+	EXPECT_EQ(by_name.id(), batch.id());
+	EXPECT_EQ(options.handle<level>(priority.id()).id(), priority.id());
+	EXPECT_THROW(options.handle<double>("batch-size"), std::logic_error);
+	EXPECT_THROW(options.handle<bool>("include"), std::logic_error);
+	EXPECT_THROW(options.handle<bool>("missing"), std::out_of_range);
+	EXPECT_THROW(options.handle<bool>(option_id{99}), std::out_of_range);
+
+	EXPECT_EQ(parse_args({"--batch-size=7"}).get(by_name), 7);
+}
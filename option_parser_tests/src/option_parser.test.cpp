@@ -2,12 +2,587 @@
 
 #include "option_parser/option_parser.hpp"
 
-// Example test case
-TEST(OptionParserTest, test) {
-	ASSERT_EQ(test(), 42);
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+enum class mode { fast, safe, debug };
+
+constexpr auto modes = make_choices<mode>({{"safe", mode::safe}, {"fast", mode::fast}, {"debug", mode::debug}});
+
+enum class codec { h264, h265, hevc, vp8, vp9, av1 };
+
+constexpr auto codecs = make_choices<codec>({
+    {"h264", codec::h264},
+    {"H265", codec::h265},
+    {"hevc", codec::hevc},
+    {"vp8", codec::vp8},
+    {"vp9", codec::vp9},
+    {"AV1", codec::av1},
+});
+
+result parse_args(const spec &options, std::vector<std::string_view> args) {
+	return parse(options, arg_list(args));
+}
+
+} // namespace
+
+TEST(OptionParserTest, ParsesLongShortAndPositionalArguments) {
+	spec options;
+	const option_id verbose = options.add_flag("verbose", 'v');
+	const option_id jobs = options.add_int("jobs", 'j', 1);
+	const option_id name = options.add_string("name", 'n', "anonymous");
+	const option_id ratio = options.add_double("ratio");
+
+	const char *argv[] = {"tool", "-vv", "--jobs=8", "in.txt", "-nbob", "--ratio", "0.5", "--", "-v"};
+	const result parsed = parse(options, 9, argv);
+
+	EXPECT_EQ(parsed.count(verbose), 2u);
+	EXPECT_TRUE(parsed.get<bool>(verbose));
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 8);
+	EXPECT_EQ(parsed.get<std::string_view>(name), "bob");
+	EXPECT_DOUBLE_EQ(parsed.get<double>("ratio"), 0.5);
+	EXPECT_EQ(parsed.get<double>(ratio), 0.5);
+	EXPECT_EQ(parsed.positionals(), (std::vector<std::string_view>{"in.txt", "-v"}));
+}
+
+TEST(OptionParserTest, UsesDefaultsForAbsentOptions) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j', 4);
+	const option_id name = options.add_string("name", '\0', "anonymous");
+	const option_id level = options.add_choice("mode", 'm', modes, mode::safe);
+
+	const result parsed = parse_args(options, {});
+	EXPECT_FALSE(parsed.has(jobs));
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 4);
+	EXPECT_EQ(parsed.get<std::string_view>(name), "anonymous");
+	EXPECT_EQ(parsed.get<mode>(level), mode::safe);
+}
+
+TEST(OptionParserTest, ShortClusterEndsAtValueOption) {
+	spec options;
+	const option_id x = options.add_flag("extract", 'x');
+	const option_id v = options.add_flag("verbose", 'v');
+	const option_id f = options.add_string("file", 'f');
+
+	const result parsed = parse_args(options, {"-xvf", "a.tar", "-vfb.tar"});
+	EXPECT_EQ(parsed.count(x), 1u);
+	EXPECT_EQ(parsed.count(v), 2u);
+	EXPECT_EQ(parsed.count(f), 2u);
+	EXPECT_EQ(parsed.get<std::string_view>(f), "b.tar");
+	EXPECT_TRUE(parsed.positionals().empty());
+}
+
+TEST(ShortOptionTest, ClustersAndAttachedValues) {
+	spec options;
+	const option_id x = options.add_flag("extract", 'x');
+	const option_id v = options.add_flag("verbose", 'v');
+	const option_id z = options.add_flag("gzip", 'z');
+	const option_id f = options.add_string("file", 'f');
+	const option_id j = options.add_int("jobs", 'j');
+	options.add_alias(v, "", 'V');
+	options.add_alias(j, "", 'J', alias_kind::deprecated);
+
+	const result parsed = parse_args(options, {"-xvzf", "a.tar", "-j8", "-Vvzj", "16", "-J4", "-f-", "-"});
+	EXPECT_EQ(parsed.count(x), 1u);
+	EXPECT_EQ(parsed.count(v), 3u);
+	EXPECT_EQ(parsed.count(z), 2u);
+	EXPECT_EQ(parsed.get<std::string_view>(f), "-");
+	EXPECT_EQ(parsed.count(j), 3u);
+	EXPECT_EQ(parsed.get<std::int64_t>(j), 4);
+	ASSERT_EQ(parsed.diagnostics().size(), 1u);
+	EXPECT_EQ(parsed.diagnostics()[0].index, 5u);
+	EXPECT_EQ(parsed.positionals(), (std::vector<std::string_view>{"-"}));
+}
+
+TEST(ShortOptionTest, EveryPrintableCharacterResolves) {
+	spec options;
+	std::vector<std::string> names;
+	for (char c = '!'; c <= '~'; ++c) {
+		if (c == '-')
+			continue;
+		names.push_back(std::string("opt") + std::to_string(static_cast<int>(c)));
+		options.add_flag(names.back(), c);
+	}
+	for (char c = '!'; c <= '~'; ++c) {
+		if (c == '-')
+			continue;
+		const std::optional<option_id> found = options.find_short(c);
+		ASSERT_TRUE(found) << c;
+		EXPECT_EQ(options.def(*found).short_name, c);
+	}
+	EXPECT_FALSE(options.find_short('-'));
+	EXPECT_FALSE(options.find_short('\0'));
+}
+
+TEST(ShortOptionTest, RejectsNonAscii) {
+	spec options;
+	options.add_flag("verbose", 'v');
+	for (const char c : {'\x80', '\xc3', '\xff', '\x7f', ' ', '\t', '\x01', '-'}) {
+		EXPECT_THROW(options.add_flag("bad", c), std::invalid_argument) << static_cast<int>(c);
+		EXPECT_THROW(options.add_alias(0, "", c), std::invalid_argument) << static_cast<int>(c);
+		EXPECT_FALSE(options.find_short(c));
+	}
+
+	// "-vé": the first byte of a two byte sequence is no option.
+	try {
+		parse_args(options, {"x", "-v\xc3\xa9"});
+		FAIL() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::unknown_option);
+		EXPECT_EQ(e.index(), 1u);
+	}
+	EXPECT_THROW(parse_args(options, {"-\xff"}), parse_error);
+}
+
+TEST(OptionParserTest, ReportsErrorsWithArgumentIndex) {
+	spec options;
+	options.add_flag("verbose", 'v');
+	options.add_int("jobs", 'j');
+
+	const auto code_of = [&](std::vector<std::string_view> args, std::size_t index) {
+		try {
+			parse_args(options, std::move(args)).validate();
+		} catch (const parse_error &e) {
+			EXPECT_EQ(e.index(), index);
+			return e.code();
+		}
+		ADD_FAILURE() << "expected a parse_error";
+		return error_code::unknown_option;
+	};
+	EXPECT_EQ(code_of({"a", "--nope"}, 1), error_code::unknown_option);
+	EXPECT_EQ(code_of({"-vq"}, 0), error_code::unknown_option);
+	EXPECT_EQ(code_of({"-v", "--jobs"}, 1), error_code::missing_value);
+	EXPECT_EQ(code_of({"--verbose=1"}, 0), error_code::unexpected_value);
+	EXPECT_EQ(code_of({"-j", "8x"}, 0), error_code::invalid_value);
+}
+
+TEST(OptionParserTest, RejectsDuplicateNamesAndWrongTypes) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	EXPECT_THROW(options.add_flag("jobs"), std::invalid_argument);
+	EXPECT_THROW(options.add_flag("other", 'j'), std::invalid_argument);
+
+	const result parsed = parse_args(options, {});
+	EXPECT_THROW(parsed.get<std::string_view>(jobs), std::logic_error);
+	EXPECT_THROW(parsed.get<std::int64_t>("missing"), std::out_of_range);
+}
+
+TEST(AliasTest, AliasesShareTheOptionSlot) {
+	spec options;
+	const option_id verbose = options.add_flag("verbose", 'v');
+	const option_id jobs = options.add_int("jobs", 'j', 1);
+	options.add_alias(jobs, "parallel", 'P');
+	options.add_alias(jobs, "threads", 'T', alias_kind::deprecated);
+
+	EXPECT_EQ(options.find_long("parallel"), jobs);
+	EXPECT_EQ(options.find_short('T'), jobs);
+	EXPECT_EQ(options.id("threads"), jobs);
+	EXPECT_TRUE(options.resolve_long("threads")->deprecated);
+	EXPECT_FALSE(options.resolve_long("jobs")->deprecated);
+
+	const result parsed = parse_args(options, {"--parallel=2", "-P3", "--jobs", "4"});
+	EXPECT_EQ(parsed.count(jobs), 3u);
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 4);
+	EXPECT_TRUE(parsed.diagnostics().empty());
+	EXPECT_FALSE(parsed.has(verbose));
+}
+
+TEST(AliasTest, DeprecatedUsesBecomeDiagnostics) {
+	spec options;
+	options.add_flag("verbose", 'v');
+	const option_id jobs = options.add_int("jobs", 'j');
+	options.add_alias(jobs, "threads", 'T', alias_kind::deprecated);
+
+	const result parsed = parse_args(options, {"--threads=2", "x", "-vT", "3", "-j5"});
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 5);
+	ASSERT_EQ(parsed.diagnostics().size(), 2u);
+	EXPECT_EQ(parsed.diagnostics()[0].index, 0u);
+	EXPECT_EQ(parsed.diagnostics()[0].id, jobs);
+	EXPECT_EQ(parsed.diagnostics()[0].message, "option --threads is deprecated; use --jobs");
+	EXPECT_EQ(parsed.diagnostics()[1].index, 2u);
+	EXPECT_EQ(parsed.diagnostics()[1].message, "option -T is deprecated; use --jobs");
+
+	std::vector<bool> deprecated;
+	visit(
+	    options, arg_list(std::vector<std::string_view>{"-j1", "--threads", "2"}),
+	    [&](const option_value &value) { deprecated.push_back(value.deprecated); }, [](std::string_view, std::size_t) {});
+	EXPECT_EQ(deprecated, (std::vector<bool>{false, true}));
+}
+
+TEST(AliasTest, RejectsClashesAndLateAliases) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	options.add_flag("verbose", 'v');
+	EXPECT_THROW(options.add_alias(jobs, "verbose"), std::invalid_argument);
+	EXPECT_THROW(options.add_alias(jobs, "", 'v'), std::invalid_argument);
+	EXPECT_THROW(options.add_alias(jobs, ""), std::invalid_argument);
+	EXPECT_THROW(options.add_alias(7, "seven"), std::out_of_range);
+	options.add_alias(jobs, "threads");
+	EXPECT_THROW(options.add_flag("threads"), std::invalid_argument);
+	options.seal();
+	EXPECT_THROW(options.add_alias(jobs, "workers"), std::logic_error);
+}
+
+TEST(LazyConversionTest, ConvertsOnlyWhatIsRead) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	const option_id ratio = options.add_double("ratio", 'r');
+	const option_id mode_option = options.add_choice("mode", 'm', modes, mode::fast);
+
+	const result parsed = parse_args(options, {"-j", "4", "--ratio=oops", "-m", "nope"});
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 4);
+	try {
+		parsed.get<double>(ratio);
+		FAIL() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::invalid_value);
+		EXPECT_EQ(e.index(), 2u);
+	}
+	// A failed conversion is not memoized; it fails again.
+	EXPECT_THROW(parsed.get<double>(ratio), parse_error);
+	EXPECT_THROW(parsed.get<mode>(mode_option), parse_error);
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 4);
+}
+
+TEST(LazyConversionTest, ValidateReportsTheEarliestBadArgument) {
+	spec options;
+	options.add_int("jobs", 'j');
+	options.add_double("ratio", 'r');
+	const option_id mode_option = options.add_choice("mode", 'm', modes, mode::fast);
+
+	try {
+		parse_args(options, {"-m", "nope", "-j", "4", "--ratio=oops"}).validate();
+		FAIL() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.index(), 0u);
+	}
+
+	// Reads see the value kept, but validate() still rejects an overridden
+	// bad one, as the eager paths do.
+	const std::vector<std::string_view> overridden{"-j", "x", "-j4", "-m", "SAFE", "--mode=debug"};
+	const result parsed = parse_args(options, overridden);
+	EXPECT_EQ(parsed.get<std::int64_t>("jobs"), 4);
+	EXPECT_EQ(parsed.get<mode>(mode_option), mode::debug);
+	const auto eager_error = [&](auto &&run) {
+		try {
+			run();
+		} catch (const parse_error &e) {
+			return std::make_pair(e.code(), e.index());
+		}
+		ADD_FAILURE() << "expected a parse_error";
+		return std::make_pair(error_code::unknown_option, std::size_t{99});
+	};
+	const auto lazy = eager_error([&] { parsed.validate(); });
+	EXPECT_EQ(lazy, std::make_pair(error_code::invalid_value, std::size_t{0}));
+	EXPECT_EQ(eager_error([&] { visit(options, arg_list(overridden), [](const option_value &) {}, [](std::string_view, std::size_t) {}); }),
+	          lazy);
+	EXPECT_EQ(eager_error([&] {
+		          pull_parser events(options, arg_list(overridden));
+		          for (const parse_event &event : events)
+			          (void)event;
+	          }),
+	          lazy);
+	EXPECT_EQ(eager_error([&] { parse_args(options, {"-j4", "-m", "SAFE", "-mdebug"}).validate(); }).second, 1u);
+	EXPECT_NO_THROW(parse_args(options, {"-j4", "-j5", "-mfast", "-msafe"}).validate());
+	EXPECT_NO_THROW(parse_args(options, {}).validate());
+}
+
+TEST(ListOptionTest, KeepsArgumentOrderPerOption) {
+	spec options;
+	const option_id include = options.add_list("include", 'I');
+	const option_id define = options.add_list("define", 'D');
+	const option_id unused = options.add_list("unused");
+
+	const result parsed =
+	    parse_args(options, {"-Ia", "--define", "X=1", "main.c", "-I", "b", "--include=c", "-DY=2", "-Ia"});
+	const string_span includes = parsed.get<string_span>(include);
+	EXPECT_EQ(std::vector<std::string_view>(includes.begin(), includes.end()),
+	          (std::vector<std::string_view>{"a", "b", "c", "a"}));
+	const string_span defines = parsed.get<string_span>(define);
+	EXPECT_EQ(std::vector<std::string_view>(defines.begin(), defines.end()),
+	          (std::vector<std::string_view>{"X=1", "Y=2"}));
+	EXPECT_TRUE(parsed.get<string_span>(unused).empty());
+	EXPECT_EQ(parsed.count(include), 4u);
+	EXPECT_EQ(parsed.positionals(), (std::vector<std::string_view>{"main.c"}));
+}
+
+TEST(ListOptionTest, ManyRepeatsShareOneBuffer) {
+	spec options;
+	const option_id include = options.add_list("include", 'I');
+	const option_id define = options.add_list("define", 'D');
+
+	std::vector<std::string> storage;
+	for (int i = 0; i < 20000; ++i)
+		storage.push_back((i % 3 == 0 ? "-DN" : "-Idir") + std::to_string(i));
+	const std::vector<std::string_view> args(storage.begin(), storage.end());
+
+	const result parsed = parse(options, arg_list(args));
+	const string_span includes = parsed.get<string_span>(include);
+	const string_span defines = parsed.get<string_span>(define);
+	ASSERT_EQ(includes.size() + defines.size(), args.size());
+	// Both lists live back to back in a single allocation.
+	EXPECT_EQ(includes.data() + includes.size(), defines.data());
+	std::size_t next_include = 0;
+	std::size_t next_define = 0;
+	for (std::size_t i = 0; i < args.size(); ++i) {
+		if (i % 3 == 0)
+			EXPECT_EQ(defines[next_define++], args[i].substr(2));
+		else
+			EXPECT_EQ(includes[next_include++], args[i].substr(2));
+	}
+}
+
+TEST(ListOptionTest, ApplyRequiresReservedStorage) {
+	spec options;
+	const option_id include = options.add_list("include", 'I');
+	result manual(options);
+	token tok{token::type::option, include, "dir", 0, {}, false};
+	EXPECT_THROW(manual.apply(tok), std::logic_error);
+
+	manual.reserve_values({1});
+	manual.apply(tok);
+	EXPECT_EQ(manual.get<string_span>(include)[0], "dir");
+	EXPECT_THROW(manual.apply(tok), std::logic_error);
+}
+
+TEST(MapOptionTest, CollectsPairsFromRepeatsAndSeparatedLists) {
+	spec options;
+	const option_id label = options.add_map("label", 'l');
+	const option_id labels = options.add_map("labels", '\0', ',');
+
+	const result parsed = parse_args(options, {"--label", "team=infra", "-lowner=a=b", "--labels=x=1,y=,z=3"});
+	const flat_string_map &single = parsed.get<flat_string_map>(label);
+	ASSERT_EQ(single.size(), 2u);
+	EXPECT_EQ(single.find("team")->value, "infra");
+	EXPECT_EQ(single.find("owner")->value, "a=b");
+
+	const flat_string_map &several = parsed.get<flat_string_map>("labels");
+	ASSERT_EQ(several.size(), 3u);
+	EXPECT_EQ(several.find("x")->value, "1");
+	EXPECT_EQ(several.find("y")->value, "");
+	EXPECT_EQ(several.find("z")->value, "3");
+	EXPECT_EQ(parsed.count(labels), 1u);
+
+	EXPECT_THROW(parse_args(options, {"--label", "novalue"}), parse_error);
+	EXPECT_THROW(parse_args(options, {"--label", "=v"}), parse_error);
+	EXPECT_THROW(parse_args(options, {"--labels", "a=1,,b=2"}), parse_error);
+	EXPECT_THROW(options.add_map("bad", '\0', '='), std::invalid_argument);
+}
+
+TEST(MapOptionTest, KeysViewTheArguments) {
+	spec options;
+	const option_id label = options.add_map("label");
+	const std::vector<std::string_view> args{"--label=key=value"};
+	const result parsed = parse(options, arg_list(args));
+	const flat_string_map::entry &entry = *parsed.get<flat_string_map>(label).begin();
+	EXPECT_EQ(entry.key.data(), args[0].data() + 8);
+	EXPECT_EQ(entry.value.data(), args[0].data() + 12);
+}
+
+TEST(MapOptionTest, DuplicateKeyPolicies) {
+	spec options;
+	const option_id last = options.add_map("last", '\0', ',');
+	const option_id first = options.add_map("first", '\0', ',', duplicate_key::first_wins);
+	options.add_map("strict", '\0', ',', duplicate_key::reject);
+
+	const result parsed = parse_args(options, {"--last=k=1,k=2", "--last", "k=3", "--first=k=1", "--first=j=0,k=2"});
+	EXPECT_EQ(parsed.get<flat_string_map>(last).size(), 1u);
+	EXPECT_EQ(parsed.get<flat_string_map>(last).find("k")->value, "3");
+	EXPECT_EQ(parsed.get<flat_string_map>(first).size(), 2u);
+	EXPECT_EQ(parsed.get<flat_string_map>(first).find("k")->value, "1");
+
+	EXPECT_NO_THROW(parse_args(options, {"--strict=a=1,b=1"}));
+	try {
+		parse_args(options, {"--strict=a=1", "--strict", "b=1,a=2"});
+		FAIL() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::invalid_value);
+		EXPECT_EQ(e.index(), 1u);
+	}
+}
+
+TEST(ParseTokensTest, PiecesApplyLikeTheWholeList) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	const option_id include = options.add_list("include", 'I');
+	const option_id labels = options.add_map("labels", 'l', ',');
+	const std::vector<std::string_view> first{"-j", "2", "-Ia", "--labels=x=1,y=2"};
+	const std::vector<std::string_view> second{"-Ib", "file", "-j3"};
+
+	std::vector<token> tokens = tokenize(options, arg_list(first));
+	for (token tok : tokenize(options, arg_list(second))) {
+		tok.index += first.size();
+		tokens.push_back(tok);
+	}
+	const result parsed = parse_tokens(options, tokens);
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 3);
+	const string_span included = parsed.get<string_span>(include);
+	EXPECT_EQ(std::vector<std::string_view>(included.begin(), included.end()),
+	          (std::vector<std::string_view>{"a", "b"}));
+	EXPECT_EQ(parsed.get<flat_string_map>(labels).size(), 2u);
+	EXPECT_EQ(parsed.positionals(), std::vector<std::string_view>{"file"});
+
+	// A value never comes from the next piece.
+	EXPECT_THROW(tokenize(options, arg_list(std::vector<std::string_view>{"-I"})), parse_error);
+	parse_limits limits;
+	limits.max_values = 1;
+	EXPECT_THROW(parse_tokens(options, tokens, limits), limit_error);
+}
+
+TEST(VisitTest, CallbacksFollowArgumentOrder) {
+	spec options;
+	const option_id verbose = options.add_flag("verbose", 'v');
+	const option_id jobs = options.add_int("jobs", 'j');
+	const option_id ratio = options.add_double("ratio");
+	const option_id level = options.add_choice("mode", 'm', modes, mode::safe, choice_match::prefix);
+	const option_id include = options.add_list("include", 'I');
+	const option_id label = options.add_map("label", '\0', ',');
+
+	std::vector<std::string> events;
+	visit(
+	    options, arg_list(std::vector<std::string_view>{"src", "-vj4", "--label=a=1,b=2", "-Ix", "--ratio", "2.5", "-md",
+	                                                     "--", "-v"}),
+	    [&](const option_value &value) {
+		    std::string event = std::to_string(value.index) + ":";
+		    if (value.id == verbose)
+			    event += "verbose=" + std::to_string(value.as<bool>());
+		    else if (value.id == jobs)
+			    event += "jobs=" + std::to_string(value.as<std::int64_t>());
+		    else if (value.id == ratio)
+			    event += "ratio=" + std::to_string(value.as<double>()).substr(0, 3);
+		    else if (value.id == level)
+			    event += "mode=" + std::string(value.text) + (value.as<mode>() == mode::debug ? "!" : "?");
+		    else if (value.id == include)
+			    event += "include=" + std::string(value.as<std::string_view>());
+		    else if (value.id == label)
+			    event += "label." + std::string(value.key) + "=" + std::string(value.text);
+		    events.push_back(event);
+	    },
+	    [&](std::string_view value, std::size_t index) {
+		    events.push_back(std::to_string(index) + ":" + std::string(value));
+	    });
+
+	EXPECT_EQ(events, (std::vector<std::string>{"0:src", "1:verbose=1", "1:jobs=4", "2:label.a=1", "2:label.b=2",
+	                                            "3:include=x", "4:ratio=2.5", "6:mode=debug!", "8:-v"}));
+}
+
+TEST(VisitTest, StopsAtFirstErrorAfterEarlierCallbacks) {
+	spec options;
+	options.add_int("jobs", 'j');
+	std::size_t seen = 0;
+	const auto count = [&](auto &&...) { ++seen; };
+	EXPECT_THROW(visit(options, arg_list(std::vector<std::string_view>{"a", "-j1", "-jx", "b"}), count, count),
+	             parse_error);
+	EXPECT_EQ(seen, 2u);
+}
+
+TEST(VisitTest, TypedAccessIsChecked) {
+	option_value value;
+	value.kind = value_kind::integer;
+	value.integer = 7;
+	EXPECT_EQ(value.as<std::int64_t>(), 7);
+	EXPECT_THROW(value.as<double>(), std::logic_error);
+	EXPECT_THROW(value.as<std::string_view>(), std::logic_error);
+}
+
+TEST(ChoiceTableTest, IsSortedAtCompileTime) {
+	static_assert(modes.size() == 3);
+	static_assert(modes.entries()[0].name == "debug");
+	static_assert(modes.entries()[1].name == "fast");
+	static_assert(modes.entries()[2].name == "safe");
+	static_assert(modes.find("fast") == mode::fast);
+	static_assert(!modes.find("FAST"));
+
+	static_assert(codecs.entries()[0].name == "AV1");
+	static_assert(codecs.entries()[1].name == "h264");
+	static_assert(codecs.entries()[2].name == "H265");
+}
+
+TEST(ChoiceTableTest, ExactMatch) {
+	EXPECT_EQ(codecs.find("h264"), codec::h264);
+	EXPECT_EQ(codecs.find("H265"), codec::h265);
+	EXPECT_EQ(codecs.find("AV1"), codec::av1);
+	EXPECT_FALSE(codecs.find("h265"));
+	EXPECT_FALSE(codecs.find("av1"));
+	EXPECT_FALSE(codecs.find("vp"));
+	EXPECT_FALSE(codecs.find(""));
+}
+
+TEST(ChoiceTableTest, IgnoreCaseMatch) {
+	EXPECT_EQ(codecs.find("H264", choice_match::ignore_case), codec::h264);
+	EXPECT_EQ(codecs.find("h265", choice_match::ignore_case), codec::h265);
+	EXPECT_EQ(codecs.find("Av1", choice_match::ignore_case), codec::av1);
+	EXPECT_EQ(codecs.find("HEVC", choice_match::ignore_case), codec::hevc);
+	EXPECT_FALSE(codecs.find("hev", choice_match::ignore_case));
+	EXPECT_FALSE(codecs.find("vp10", choice_match::ignore_case));
+}
+
+TEST(ChoiceTableTest, PrefixMatch) {
+	EXPECT_EQ(codecs.find("he", choice_match::prefix), codec::hevc);
+	EXPECT_EQ(codecs.find("A", choice_match::prefix), codec::av1);
+	EXPECT_EQ(codecs.find("vp8", choice_match::prefix), codec::vp8);
+	// Prefix matching keeps case: "h2" only reaches h264, "H2" only H265.
+	EXPECT_EQ(codecs.find("h2", choice_match::prefix), codec::h264);
+	EXPECT_EQ(codecs.find("H2", choice_match::prefix), codec::h265);
+	EXPECT_FALSE(codecs.find("a", choice_match::prefix));
+	EXPECT_FALSE(codecs.find("vp", choice_match::prefix));
+	EXPECT_FALSE(codecs.find("", choice_match::prefix));
+
+	const choice_lookup ambiguous = find_choice(codecs.entries().data(), codecs.size(), "vp", choice_match::prefix);
+	EXPECT_EQ(ambiguous.entry, nullptr);
+	EXPECT_EQ(ambiguous.candidates, 2u);
+}
+
+TEST(ChoiceTableTest, LargeTableFindsEveryEntry) {
+	enum class region : int {};
+	static const std::vector<std::string> names = [] {
+		std::vector<std::string> out;
+		for (int i = 0; i < 256; ++i)
+			out.push_back("region-" + std::to_string((i * 7919) % 1000));
+		return out;
+	}();
+	choice<region> raw[256];
+	for (int i = 0; i < 256; ++i)
+		raw[i] = {names[i], static_cast<region>(i)};
+	const auto regions = make_choices<region>(raw);
+
+	for (int i = 0; i < 256; ++i) {
+		EXPECT_EQ(regions.find(names[i]), static_cast<region>(i));
+		std::string upper = names[i];
+		upper[0] = 'R';
+		EXPECT_EQ(regions.find(upper, choice_match::ignore_case), static_cast<region>(i));
+	}
+	EXPECT_THROW(make_choices<region>({{"a", region{}}, {"A", region{}}}), std::invalid_argument);
+}
+
+TEST(ChoiceOptionTest, ParsesEachMatchMode) {
+	spec options;
+	const option_id exact = options.add_choice("exact", '\0', codecs, codec::h264);
+	const option_id folded = options.add_choice("folded", '\0', codecs, codec::h264, choice_match::ignore_case);
+	const option_id prefix = options.add_choice("prefix", 'p', codecs, codec::h264, choice_match::prefix);
+
+	const result parsed = parse_args(options, {"--exact=vp9", "--folded", "hEvC", "-pA"});
+	EXPECT_EQ(parsed.get<codec>(exact), codec::vp9);
+	EXPECT_EQ(parsed.get<codec>(folded), codec::hevc);
+	EXPECT_EQ(parsed.get<codec>(prefix), codec::av1);
+
+	EXPECT_THROW(parse_args(options, {"--exact=VP9"}).validate(), parse_error);
+	EXPECT_THROW(parse_args(options, {"--prefix=vp"}).validate(), parse_error);
+	try {
+		parse_args(options, {"--folded", "x", "--prefix", "vp"}).validate();
+		FAIL() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::invalid_value);
+		EXPECT_EQ(e.index(), 0u);
+	}
 }
 
 int main(int argc, char **argv) {
 	::testing::InitGoogleTest(&argc, argv);
 	return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/pattern.hpp"
+#include "option_parser/option_parser.hpp"
+
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+const std::vector<std::string> simple_patterns{
+    "[a-z0-9-]{1,63}", "^[A-Fa-f0-9]{8}$", "\\d+", "\\w*", "\\s?", "[^/]*", "[-+.]{2,}", "[a-c\\]x-]{0,3}",
+    "[\\d_]+", ".{3}", "[^\\s]{1,}", "[0-9]",
+};
+
+// Values that probe lengths, class edges, high bytes and line breaks.
+std::vector<std::string> probes() {
+	std::vector<std::string> values{"", "abc", "a-b-c", "ABCDEF01", "abcdef012", "12345", "a_1", " ", "\t\n",
+	                                "/etc", "etc", "+-", "+", "]x-", "b]", "\\", "a\nb", "a\rb", "..."};
+	values.push_back(std::string(63, 'a'));
+	values.push_back(std::string(64, 'a'));
+	for (int c = 0; c < 256; ++c)
+		values.push_back(std::string(1, static_cast<char>(c)));
+	values.push_back(std::string("\xc3\xa9t\xc3\xa9"));
+	return values;
+}
+
+} // namespace
+
+TEST(PatternTest, SimplePatternsSkipRegex) {
+	for (const std::string &source : simple_patterns)
+		EXPECT_TRUE(string_pattern(source).is_simple()) << source;
+	for (const char *source : {"v[0-9]+", "(a|b)+", "[[:alpha:]]+", "a", "[a-z]+?", "\\D+", "\\d{2}?", "x*$\\$", ""})
+		EXPECT_FALSE(string_pattern(source).is_simple()) << source;
+}
+
+// The byte set fast path must agree with std::regex on every probe.
+TEST(PatternTest, FastPathMatchesRegex) {
+	const std::vector<std::string> values = probes();
+	for (const std::string &source : simple_patterns) {
+		const string_pattern pattern(source);
+		const std::regex reference(source, std::regex::ECMAScript);
+		for (const std::string &value : values)
+			EXPECT_EQ(pattern.matches(value), std::regex_match(value, reference)) << source << " on '" << value << "'";
+	}
+}
+
+TEST(PatternTest, FallsBackToRegex) {
+	const string_pattern version("v[0-9]+(\\.[0-9]+)*");
+	EXPECT_TRUE(version.matches("v1.2.3"));
+	EXPECT_FALSE(version.matches("v1."));
+	EXPECT_FALSE(version.matches("xv1"));
+	EXPECT_TRUE(string_pattern("").matches(""));
+	EXPECT_FALSE(string_pattern("").matches("a"));
+}
+
+TEST(PatternTest, RejectsInvalidPatterns) {
+	for (const char *source : {"[a-", "(", "[z-a]", "[\\d-z]", "a{2,1}", "*"})
+		EXPECT_THROW(string_pattern{source}, std::invalid_argument) << source;
+}
+
+TEST(PatternOptionTest, ChecksValuesWhenRead) {
+	spec options;
+	const option_id name = options.add_pattern("name", 'n', "[a-z0-9-]{1,63}");
+	const option_id tag = options.add_pattern("tag", 't', "v[0-9]+", "v1");
+
+	const result good = parse(options, arg_list(std::vector<std::string_view>{"-n", "web-01", "--tag=v20"}));
+	EXPECT_EQ(good.get<std::string_view>(name), "web-01");
+	EXPECT_EQ(good.get<std::string_view>(tag), "v20");
+	EXPECT_EQ(parse(options, arg_list(std::vector<std::string_view>{})).get<std::string_view>(tag), "v1");
+
+	const result bad = parse(options, arg_list(std::vector<std::string_view>{"--tag=v2", "-n", "Web_01"}));
+	EXPECT_EQ(bad.get<std::string_view>(tag), "v2");
+	try {
+		bad.get<std::string_view>(name);
+		FAIL() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::invalid_value);
+		EXPECT_EQ(e.index(), 1u);
+	}
+	EXPECT_THROW(bad.validate(), parse_error);
+
+	const auto ignore = [](const auto &...) {};
+	EXPECT_THROW(visit(options, arg_list(std::vector<std::string_view>{"-t", "x"}), ignore, ignore), parse_error);
+}
+
+TEST(PatternOptionTest, CompiledOncePerSpec) {
+	spec options;
+	const option_id a = options.add_pattern("a", '\0', "\\d+");
+	const option_id b = options.add_pattern("b", '\0', "\\d+");
+	const option_id c = options.add_pattern("c", '\0', "\\w+");
+	EXPECT_EQ(options.def(a).pattern, options.def(b).pattern);
+	EXPECT_NE(options.def(a).pattern, options.def(c).pattern);
+
+	// Copies of a spec share the compiled patterns.
+	const spec copy = options;
+	EXPECT_EQ(copy.def(a).pattern, options.def(a).pattern);
+
+	EXPECT_THROW(options.add_pattern("d", '\0', "("), std::invalid_argument);
+	EXPECT_THROW(options.add_pattern("e", '\0', "\\d+", "abc"), std::invalid_argument);
+}
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/option_parser.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// Stands in for a shared library: it knows nothing of the host and
+// describes its options in a spec of its own, numbered from 0.
+class mock_plugin {
+public:
+	explicit mock_plugin(std::string name, char short_name = '\0') : name_(std::move(name)), short_(short_name) {}
+
+	spec options() const {
+		spec own;
+		own.add_flag(name_ + ".enable", short_);
+		own.add_int(name_ + ".threads", '\0', 2);
+		own.add_list(name_ + ".input");
+		own.add_alias(1, name_ + ".workers", '\0', alias_kind::deprecated);
+		return own;
+	}
+
+	// Called by the host with the id its option 0 got.
+	void attach(option_id base) { base_ = base; }
+
+	option_id enable() const { return base_; }
+	option_id threads() const { return base_ + 1; }
+	option_id input() const { return base_ + 2; }
+
+	const std::string &name() const { return name_; }
+
+private:
+	std::string name_;
+	char short_;
+	option_id base_ = 0;
+};
+
+// A plugin that reads its values through the typed handles its own spec's
+// add_* returned, rebased onto the host once merged.
+struct cache_plugin {
+	spec own;
+	option_handle<bool> enable = own.add_flag("cache.enable");
+	option_handle<std::int64_t> size = own.add_int("cache.size", '\0', 64);
+	option_handle<flat_string_map> tiers = own.add_map("cache.tier", '\0', ',');
+
+	void attach(const merged_options &merged) {
+		enable = merged.rebase(enable);
+		size = merged.rebase(size);
+		tiers = merged.rebase(tiers);
+	}
+};
+
+spec host_spec() {
+	spec host;
+	host.add_flag("verbose", 'v');
+	host.add_string("config", 'c');
+	return host;
+}
+
+} // namespace
+
+TEST(PluginTest, MergedOptionsParseUnderTheirBase) {
+	spec host = host_spec();
+	std::vector<std::unique_ptr<mock_plugin>> plugins;
+	for (int i = 0; i < 32; ++i) {
+		plugins.push_back(std::make_unique<mock_plugin>("p" + std::to_string(i), i < 26 ? static_cast<char>('A' + i) : '\0'));
+		plugins.back()->attach(host.merge(plugins.back()->options()));
+	}
+	host.seal();
+	EXPECT_EQ(host.size(), 2u + 32u * 3u);
+
+	for (const auto &plugin : plugins) {
+		EXPECT_EQ(host.id(plugin->name() + ".enable"), plugin->enable());
+		EXPECT_EQ(host.id(plugin->name() + ".threads"), plugin->threads());
+		EXPECT_EQ(host.find_long(plugin->name() + ".workers"), plugin->threads());
+		EXPECT_EQ(host.group(plugin->name())->child("input")->option(), plugin->input());
+	}
+	EXPECT_EQ(host.find_short('C'), plugins[2]->enable());
+	EXPECT_EQ(host.id("config"), 1u);
+
+	const mock_plugin &p7 = *plugins[7];
+	const std::vector<std::string_view> args{"-vH", "--p7.threads=8", "--p7.input", "a", "--p30.workers=3", "x"};
+	const result parsed = parse(host, arg_list(args));
+	EXPECT_TRUE(parsed.get<bool>(0));
+	EXPECT_TRUE(parsed.get<bool>(p7.enable()));
+	EXPECT_EQ(parsed.get<std::int64_t>(p7.threads()), 8);
+	EXPECT_EQ(parsed.get<string_span>(p7.input()).size(), 1u);
+	EXPECT_EQ(parsed.get<std::int64_t>(plugins[30]->threads()), 3);
+	EXPECT_EQ(parsed.get<std::int64_t>(plugins[31]->threads()), 2);
+	ASSERT_EQ(parsed.diagnostics().size(), 1u);
+	EXPECT_EQ(parsed.diagnostics()[0].id, plugins[30]->threads());
+	EXPECT_EQ(parsed.positionals(), (std::vector<std::string_view>{"x"}));
+}
+
+TEST(PluginTest, ClashesLeaveTheHostUnchanged) {
+	spec host = host_spec();
+	mock_plugin first("net", 'n');
+	first.attach(host.merge(first.options()));
+
+	spec long_clash;
+	long_clash.add_flag("other");
+	long_clash.add_flag("net.threads");
+	spec short_clash;
+	short_clash.add_flag("other", 'n');
+	spec alias_clash;
+	alias_clash.add_flag("other");
+	alias_clash.add_alias(0, "config");
+
+	for (spec *clash : {&long_clash, &short_clash, &alias_clash}) {
+		EXPECT_THROW(host.merge(*clash), std::invalid_argument);
+		EXPECT_EQ(host.size(), 5u);
+		EXPECT_FALSE(host.find_long("other"));
+		EXPECT_FALSE(host.group("other"));
+	}
+	EXPECT_EQ(host.find_short('n'), first.enable());
+
+	host.seal();
+	EXPECT_THROW(host.merge(spec()), std::logic_error);
+}
+
+// Options added one at a time, merged in batches of every size, and
+// aliases interleaved must all stay reachable.
+TEST(PluginTest, InterleavedAddsAndMergesStayIndexed) {
+	spec host;
+	std::vector<std::string> names;
+	for (int batch = 0; batch < 40; ++batch) {
+		host.add_int("core" + std::to_string(batch));
+		names.push_back("core" + std::to_string(batch));
+		spec plugin;
+		for (int i = 0; i < batch % 7; ++i) {
+			plugin.add_flag("b" + std::to_string(batch) + "-" + std::to_string(i));
+			names.push_back("b" + std::to_string(batch) + "-" + std::to_string(i));
+		}
+		host.merge(std::move(plugin));
+		host.add_alias(host.id(names.front()), "alias" + std::to_string(batch));
+	}
+	for (const std::string &name : names)
+		EXPECT_EQ(host.def(host.id(name)).long_name, name);
+	for (int batch = 0; batch < 40; ++batch)
+		EXPECT_EQ(host.find_long("alias" + std::to_string(batch)), 0u);
+	EXPECT_FALSE(host.find_long("b0-0"));
+	EXPECT_FALSE(host.find_long("core40"));
+}
+
+TEST(PluginTest, HandlesReadAfterRebasing) {
+	spec host = host_spec();
+	mock_plugin first("net");
+	first.attach(host.merge(first.options()));
+	cache_plugin cache;
+	const merged_options merged = host.merge(cache.own);
+	EXPECT_EQ(merged.base(), 5u);
+	EXPECT_EQ(merged.size(), 3u);
+	const option_handle<std::int64_t> stale = cache.size;
+	cache.attach(merged);
+	host.seal();
+
+	EXPECT_EQ(cache.size.id(), merged.base() + 1);
+	const std::vector<std::string_view> args{"--cache.size=512", "--cache.tier=ram=1,disk=2", "-v"};
+	const result parsed = parse(host, arg_list(args));
+	EXPECT_FALSE(parsed.get(cache.enable));
+	EXPECT_EQ(parsed.get(cache.size), 512);
+	EXPECT_EQ(parsed.get(cache.tiers).find("disk")->value, "2");
+	EXPECT_EQ(parse(host, arg_list(std::vector<std::string_view>{})).get(cache.size), 64);
+
+	// A handle of a spec that was not merged here names no merged option.
+	spec other;
+	for (int i = 0; i < 4; ++i)
+		other.add_flag("o" + std::to_string(i));
+	EXPECT_THROW(merged.rebase(other.add_int("late")), std::out_of_range);
+#ifndef NDEBUG
+	// Reading through one not rebased trips a debug check: id 1 here is --config.
+	EXPECT_DEATH(parsed.get(stale), "");
+#endif
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/published_config.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// A config's values view its own arguments, so a copy would dangle.
+static_assert(!std::is_copy_constructible_v<config> && !std::is_move_constructible_v<config>);
+static_assert(!std::is_copy_assignable_v<config> && !std::is_move_assignable_v<config>);
+
+struct runtime_flags {
+	spec options;
+	option_id jobs = options.add_int("jobs", 'j', 1);
+	option_id name = options.add_string("name", 'n');
+
+	runtime_flags() { options.seal(); }
+
+	// A config whose name spells out its jobs, so a reader can tell a whole
+	// config from a torn or freed one.
+	std::shared_ptr<const config> make(std::uint64_t generation) const {
+		const std::string value = std::to_string(generation);
+		return config::make(options, {"--jobs=" + value, "--name=n" + value}, generation);
+	}
+
+	bool whole(const config &c) const {
+		return c.values().get<std::string_view>(name) == "n" + std::to_string(c.values().get<std::int64_t>(jobs)) &&
+		       c.values().get<std::int64_t>(jobs) == static_cast<std::int64_t>(c.generation());
+	}
+};
+
+} // namespace
+
+TEST(PublishedConfigTest, ReadersSeeInstalledConfigs) {
+	const runtime_flags flags;
+	published_config published(flags.make(1));
+	const published_config::reader reader(published);
+	EXPECT_EQ(reader.read()->generation(), 1u);
+
+	published.install(flags.make(2));
+	{
+		const published_config::guard current = reader.read();
+		EXPECT_EQ(current->generation(), 2u);
+		EXPECT_TRUE(flags.whole(*current));
+	}
+	EXPECT_EQ(published.current()->generation(), 2u);
+
+	EXPECT_THROW(published.install(nullptr), std::invalid_argument);
+	EXPECT_THROW(published_config(nullptr), std::invalid_argument);
+	EXPECT_THROW(config::make(flags.options, {"--jobs=x"}), parse_error);
+}
+
+TEST(PublishedConfigTest, KeepsRetiredConfigsWhileReadersHoldThem) {
+	const runtime_flags flags;
+	published_config published(flags.make(1));
+	const published_config::reader reader(published);
+	const published_config::reader idle(published);
+
+	std::weak_ptr<const config> first = published.current();
+	std::weak_ptr<const config> second;
+	{
+		const published_config::guard held = reader.read();
+		published.install(flags.make(2));
+		second = published.current();
+		published.install(flags.make(3));
+		EXPECT_FALSE(first.expired());
+		EXPECT_FALSE(second.expired()) << "retired after the guard's epoch began";
+		EXPECT_EQ(published.reclaim(), 2u);
+		EXPECT_EQ(held->generation(), 1u);
+	}
+	EXPECT_EQ(published.reclaim(), 0u);
+	EXPECT_TRUE(first.expired());
+	EXPECT_TRUE(second.expired());
+
+	// A guard taken after an install does not hold what that install retired.
+	const published_config::guard current = reader.read();
+	std::weak_ptr<const config> third = published.current();
+	published.install(flags.make(4));
+	EXPECT_FALSE(third.expired());
+	EXPECT_EQ(published.reclaim(), 1u);
+}
+
+TEST(PublishedConfigTest, ReaderSlotsAreReused) {
+	const runtime_flags flags;
+	published_config published(flags.make(1), 2);
+	auto a = std::make_unique<published_config::reader>(published);
+	const published_config::reader b(published);
+	EXPECT_THROW(published_config::reader c(published), std::length_error);
+	a.reset();
+	const published_config::reader c(published);
+	EXPECT_EQ(c.read()->generation(), 1u);
+}
+
+// One writer installs configs as fast as it can while readers read them in
+// a loop. Every config a reader sees must be whole and no older than the
+// last one it saw, and once the readers stop everything retired is
+// released. Run under ThreadSanitizer or AddressSanitizer to check for
+// races and use after free.
+TEST(PublishedConfigTest, StressOneWriterManyReaders) {
+	const runtime_flags flags;
+	published_config published(flags.make(1));
+	const unsigned threads = std::max(4u, std::thread::hardware_concurrency());
+	constexpr std::uint64_t installs = 3000;
+	std::atomic<bool> done{false};
+	std::atomic<int> failures{0};
+	std::atomic<std::uint64_t> reads{0};
+
+	std::vector<std::thread> readers;
+	for (unsigned t = 0; t < threads; ++t) {
+		readers.emplace_back([&] {
+			const published_config::reader reader(published);
+			std::uint64_t last = 0;
+			std::uint64_t count = 0;
+			while (!done.load(std::memory_order_relaxed)) {
+				const published_config::guard current = reader.read();
+				if (!flags.whole(*current) || current->generation() < last)
+					failures.fetch_add(1, std::memory_order_relaxed);
+				last = current->generation();
+				++count;
+			}
+			reads.fetch_add(count, std::memory_order_relaxed);
+		});
+	}
+
+	std::vector<std::weak_ptr<const config>> installed;
+	std::size_t most_waiting = 0;
+	for (std::uint64_t generation = 2; generation <= installs; ++generation) {
+		std::shared_ptr<const config> next = flags.make(generation);
+		installed.push_back(next);
+		published.install(std::move(next));
+		most_waiting = std::max(most_waiting, published.reclaim());
+	}
+	done.store(true);
+	for (std::thread &reader : readers)
+		reader.join();
+
+	EXPECT_EQ(failures.load(), 0);
+	EXPECT_GT(reads.load(), 0u);
+	EXPECT_LT(most_waiting, installs / 2) << "retired configs are released while readers run";
+	EXPECT_EQ(published.reclaim(), 0u);
+	for (std::size_t i = 0; i + 1 < installed.size(); ++i)
+		EXPECT_TRUE(installed[i].expired()) << i;
+	EXPECT_EQ(published.current()->generation(), installs);
+}
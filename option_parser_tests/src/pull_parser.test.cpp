@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/generator.hpp"
+#include "option_parser/option_parser.hpp"
+
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+struct wrapper_spec {
+	spec options;
+	option_id help = options.add_flag("help", 'h');
+	option_id verbose = options.add_flag("verbose", 'v');
+	option_id label = options.add_map("label", '\0', ',');
+};
+
+// Everything after "run" is garbage the wrapper must never look at.
+const std::vector<std::string_view> wrapper_args{"-v", "run", "--no-such-option", "-j", "--label=broken"};
+
+} // namespace
+
+TEST(PullParserTest, StopsAtFirstPositional) {
+	wrapper_spec s;
+	pull_parser parser(s.options, arg_list(wrapper_args));
+	parse_event event;
+
+	ASSERT_TRUE(parser.next(event));
+	EXPECT_EQ(event.kind, token::type::option);
+	EXPECT_EQ(event.value.id, s.verbose);
+	ASSERT_TRUE(parser.next(event));
+	EXPECT_EQ(event.kind, token::type::positional);
+	EXPECT_EQ(event.value.text, "run");
+	EXPECT_EQ(event.value.index, 1u);
+	EXPECT_EQ(parser.consumed(), 2u);
+
+	// Continuing would reach the invalid arguments.
+	EXPECT_THROW(parser.next(event), parse_error);
+}
+
+TEST(PullParserTest, IteratorStopsAtHelp) {
+	wrapper_spec s;
+	const std::vector<std::string_view> args{"-vh", "--no-such-option"};
+	pull_parser parser(s.options, arg_list(args));
+
+	std::vector<option_id> seen;
+	for (const parse_event &event : parser) {
+		seen.push_back(event.value.id);
+		if (event.value.id == s.help)
+			break;
+	}
+	EXPECT_EQ(seen, (std::vector<option_id>{s.verbose, s.help}));
+	EXPECT_EQ(parser.consumed(), 1u);
+}
+
+TEST(PullParserTest, IteratesEveryEventInOrder) {
+	wrapper_spec s;
+	const std::vector<std::string_view> args{"a", "--label", "x=1,y=2", "-v", "b"};
+	pull_parser parser(s.options, arg_list(args));
+
+	std::vector<std::string> seen;
+	for (const parse_event &event : parser) {
+		if (event.kind == token::type::positional)
+			seen.emplace_back(event.value.text);
+		else if (event.value.id == s.label)
+			seen.push_back(std::string(event.value.key) + "=" + std::string(event.value.text));
+		else
+			seen.emplace_back("-v");
+	}
+	EXPECT_EQ(seen, (std::vector<std::string>{"a", "x=1", "y=2", "-v", "b"}));
+	EXPECT_EQ(parser.consumed(), args.size());
+}
+
+#ifdef OPTION_PARSER_HAS_COROUTINES
+TEST(GeneratorTest, StopsEarlyWithoutTouchingTheRest) {
+	wrapper_spec s;
+	std::vector<std::string_view> seen;
+	for (const parse_event &event : events(s.options, arg_list(wrapper_args))) {
+		if (event.kind == token::type::positional) {
+			seen.push_back(event.value.text);
+			break;
+		}
+	}
+	EXPECT_EQ(seen, (std::vector<std::string_view>{"run"}));
+}
+
+TEST(GeneratorTest, RethrowsParseErrors) {
+	wrapper_spec s;
+	std::size_t count = 0;
+	auto all = events(s.options, arg_list(wrapper_args));
+	EXPECT_THROW(
+	    for (const parse_event &event : all) {
+		    (void)event;
+		    ++count;
+	    },
+	    parse_error);
+	EXPECT_EQ(count, 2u);
+}
+#endif
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/record_reader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace option_parser;
+
+namespace {
+
+// Pipe whose write end is fed by a thread in small chunks, so records
+// straddle reads the way they do with a real producer.
+class feeder {
+public:
+	explicit feeder(std::string data, std::size_t chunk = 7) {
+		if (::pipe(fds_) != 0)
+			throw std::runtime_error("pipe failed");
+		writer_ = std::thread([this, data = std::move(data), chunk] {
+			for (std::size_t pos = 0; pos < data.size(); pos += chunk) {
+				const std::size_t n = std::min(chunk, data.size() - pos);
+				if (::write(fds_[1], data.data() + pos, n) != static_cast<ssize_t>(n))
+					break;
+			}
+			::close(fds_[1]);
+		});
+	}
+	~feeder() {
+		writer_.join();
+		::close(fds_[0]);
+	}
+
+	int fd() const { return fds_[0]; }
+
+private:
+	int fds_[2];
+	std::thread writer_;
+};
+
+std::vector<std::string> read_all(record_reader &reader) {
+	std::vector<std::string> out;
+	std::string_view record;
+	while (reader.next(record))
+		out.emplace_back(record);
+	return out;
+}
+
+} // namespace
+
+TEST(RecordReaderTest, SplitsNewlineRecords) {
+	feeder input("alpha\nbeta\n\ngamma");
+	record_reader reader(input.fd());
+	EXPECT_EQ(read_all(reader), (std::vector<std::string>{"alpha", "beta", "", "gamma"}));
+}
+
+TEST(RecordReaderTest, SplitsNulRecordsKeepingNewlines) {
+	feeder input(std::string("a b\0line\nbreak\0", 15));
+	record_reader reader(input.fd(), '\0');
+	EXPECT_EQ(read_all(reader), (std::vector<std::string>{"a b", "line\nbreak"}));
+}
+
+TEST(RecordReaderTest, StreamsManyRecordsThroughSmallBuffer) {
+	std::string data;
+	for (int i = 0; i < 100000; ++i)
+		data += "/srv/data/file-" + std::to_string(i) + '\0';
+	feeder input(std::move(data), 4096);
+
+	record_reader reader(input.fd(), '\0', 256);
+	std::string_view record;
+	int count = 0;
+	while (reader.next(record)) {
+		ASSERT_EQ(record, "/srv/data/file-" + std::to_string(count));
+		++count;
+	}
+	EXPECT_EQ(count, 100000);
+}
+
+TEST(RecordReaderTest, GrowsForLongRecordsUpToLimit) {
+	const std::string long_record(1000, 'x');
+	{
+		feeder input("short\n" + long_record + "\nend\n");
+		record_reader reader(input.fd(), '\n', 16, 1000);
+		EXPECT_EQ(read_all(reader), (std::vector<std::string>{"short", long_record, "end"}));
+	}
+	{
+		feeder input("short\n" + long_record + "y\nend\n");
+		record_reader reader(input.fd(), '\n', 16, 1000);
+		std::string_view record;
+		ASSERT_TRUE(reader.next(record));
+		EXPECT_THROW(reader.next(record), std::length_error);
+	}
+}
+
+TEST(RecordReaderTest, EmptyStreamHasNoRecords) {
+	feeder input("");
+	record_reader reader(input.fd());
+	std::string_view record;
+	EXPECT_FALSE(reader.next(record));
+	EXPECT_FALSE(reader.next(record));
+}
+
+TEST(RecordReaderTest, DashPositionalIsFedFromStream) {
+	spec options;
+	options.add_flag("null", '0');
+	const std::vector<std::string_view> args{"first", "-0", "-", "last"};
+	const result parsed = parse(options, arg_list(args));
+
+	feeder input(std::string("x\0y\0", 4));
+	std::vector<std::string> seen;
+	const std::size_t count = for_each_positional(parsed, input.fd(), '\0', [&](std::string_view value) {
+		seen.emplace_back(value);
+	});
+	EXPECT_EQ(count, 4u);
+	EXPECT_EQ(seen, (std::vector<std::string>{"first", "x", "y", "last"}));
+}
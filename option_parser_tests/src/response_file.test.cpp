@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/response_file.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+// Serves response files from memory.
+file_loader files(std::map<std::string, std::string, std::less<>> contents) {
+	return [contents = std::move(contents)](std::string_view path, std::size_t) -> std::optional<std::string> {
+		const auto found = contents.find(path);
+		if (found == contents.end())
+			return std::nullopt;
+		return found->second;
+	};
+}
+
+error_code error_of(const std::vector<std::string_view> &args, const file_loader &load, const parse_limits &limits = {},
+                    std::size_t expected_index = 0) {
+	try {
+		expand_response_files(arg_list(args), load, limits);
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.index(), expected_index);
+		return e.code();
+	}
+	ADD_FAILURE() << "expected a parse_error";
+	return error_code::unknown_option;
+}
+
+} // namespace
+
+TEST(ResponseFileTest, ExpandsInPlace) {
+	const auto load = files({{"flags", "-v --name 'two words'\n# comment\n-j 4"}});
+	const std::vector<std::string_view> args{"first", "@flags", "last", "@"};
+	const expanded_args expanded = expand_response_files(arg_list(args), load);
+	EXPECT_EQ(expanded.args(),
+	          (std::vector<std::string_view>{"first", "-v", "--name", "two words", "-j", "4", "last", "@"}));
+	// Untouched arguments still view the original list.
+	EXPECT_EQ(expanded[0].data(), args[0].data());
+}
+
+TEST(ResponseFileTest, ExpandsNestedFiles) {
+	const auto load = files({{"outer", "a @inner d"}, {"inner", "b @leaf"}, {"leaf", "c"}});
+	const std::vector<std::string_view> args{"@outer", "@leaf"};
+	const expanded_args expanded = expand_response_files(arg_list(args), load);
+	EXPECT_EQ(expanded.args(), (std::vector<std::string_view>{"a", "b", "c", "d", "c"}));
+}
+
+TEST(ResponseFileTest, FeedsTheParser) {
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	const auto load = files({{"args", "--jobs=12 input"}});
+	const std::vector<std::string_view> args{"@args"};
+	const expanded_args expanded = expand_response_files(arg_list(args), load);
+	const result parsed = parse(options, expanded);
+	EXPECT_EQ(parsed.get<std::int64_t>(jobs), 12);
+	EXPECT_EQ(parsed.positionals(), (std::vector<std::string_view>{"input"}));
+}
+
+TEST(ResponseFileTest, ReportsErrorsAgainstTopLevelArgument) {
+	const auto load = files({{"self", "x @self"}, {"big", std::string(100, 'x')}, {"bad", "'open"}, {"missing", "@gone"}});
+	EXPECT_EQ(error_of({"a", "@nope"}, load, {}, 1), error_code::response_file);
+	EXPECT_EQ(error_of({"@missing"}, load), error_code::response_file);
+	EXPECT_EQ(error_of({"@self"}, load), error_code::limit_exceeded);
+	EXPECT_EQ(error_of({"@bad"}, load), error_code::bad_quoting);
+
+	parse_limits limits;
+	limits.max_response_bytes = 99;
+	EXPECT_EQ(error_of({"@big"}, load, limits), error_code::limit_exceeded);
+	limits.max_response_bytes = 100;
+	EXPECT_NO_THROW(expand_response_files(arg_list(std::vector<std::string_view>{"@big"}), load, limits));
+}
+
+TEST(ResponseFileTest, ReadsFromDisk) {
+	const std::string path = ::testing::TempDir() + "option_parser_response_file.txt";
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << "--from-disk \"quoted value\"\n";
+	}
+	const std::string arg = "@" + path;
+	const std::vector<std::string_view> args{arg};
+	const expanded_args expanded = expand_response_files(arg_list(args));
+	EXPECT_EQ(expanded.args(), (std::vector<std::string_view>{"--from-disk", "quoted value"}));
+	std::remove(path.c_str());
+	EXPECT_FALSE(read_file(path));
+}
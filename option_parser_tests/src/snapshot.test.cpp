@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/snapshot.hpp"
+#include "test_options.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+using option_parser_test::every_kind_spec;
+using option_parser_test::level;
+
+namespace {
+
+// Appends value in little-endian order, as the fixture below was written.
+template <typename T>
+void put_le(std::string &out, T value) {
+	std::uint64_t bits = 0;
+	std::memcpy(&bits, &value, sizeof value);
+	for (std::size_t i = 0; i < sizeof value; ++i)
+		out += static_cast<char>(bits >> (8 * i));
+}
+
+bool little_endian() {
+	const std::uint16_t one = 1;
+	char first;
+	std::memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+} // namespace
+
+TEST(SnapshotTest, RoundTripsEveryKind) {
+	every_kind_spec s;
+	const std::vector<std::string_view> args{"-vv", "--jobs=8", "input.txt", "-p", "high", "-I/usr/include", "-I/opt",
+	                                         "-l", "zone=eu,tier=gold", "--label=zone=us", "--", "-x"};
+	const result parsed = parse(s.options, arg_list(args));
+	const std::string bytes = save_snapshot(parsed);
+	const result restored = restore_snapshot(s.options, bytes);
+
+	EXPECT_EQ(restored.count(s.verbose), 2u);
+	EXPECT_EQ(restored.get<std::int64_t>(s.jobs), 8);
+	EXPECT_EQ(restored.get<double>(s.ratio), 0.5);
+	EXPECT_FALSE(restored.has(s.ratio));
+	EXPECT_EQ(restored.get<std::string_view>(s.name), "worker");
+	EXPECT_EQ(restored.get<level>(s.priority), level::high);
+	const string_span include = restored.get<string_span>(s.include);
+	EXPECT_EQ(std::vector<std::string_view>(include.begin(), include.end()),
+	          (std::vector<std::string_view>{"/usr/include", "/opt"}));
+	const flat_string_map &label = restored.get<flat_string_map>(s.label);
+	ASSERT_EQ(label.size(), 2u);
+	EXPECT_EQ(label.find("zone")->value, "us");
+	EXPECT_EQ(label.begin()->key, "zone");
+	EXPECT_EQ(restored.positionals(), (std::vector<std::string_view>{"input.txt", "-x"}));
+
+	// Strings view the snapshot rather than copies of it.
+	const char *text = restored.get<std::string_view>(s.name).data();
+	EXPECT_TRUE(text >= bytes.data() && text < bytes.data() + bytes.size());
+	EXPECT_EQ(save_snapshot(restored), bytes);
+}
+
+TEST(SnapshotTest, RestoresFromMappedFile) {
+	every_kind_spec s;
+	const std::vector<std::string_view> args{"-j", "3", "-I", "a", "-I", "b", "rest"};
+	const std::string path = ::testing::TempDir() + "option_parser_snapshot.bin";
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << save_snapshot(parse(s.options, arg_list(args)));
+	}
+	const mapped_file file(path);
+	const result restored = restore_snapshot(s.options, file.bytes());
+	EXPECT_EQ(restored.get<std::int64_t>(s.jobs), 3);
+	EXPECT_EQ(restored.get<string_span>(s.include).size(), 2u);
+	EXPECT_EQ(restored.positionals(), (std::vector<std::string_view>{"rest"}));
+	std::remove(path.c_str());
+	EXPECT_THROW(mapped_file{path}, std::system_error);
+}
+
+// Version 1 bytes written by hand; a reader must keep accepting them.
+TEST(SnapshotTest, ReadsVersionOneFixture) {
+	if (!little_endian())
+		GTEST_SKIP() << "fixture is little-endian";
+	spec options;
+	const option_id jobs = options.add_int("jobs", 'j');
+	const option_id include = options.add_list("include", 'I');
+
+	std::string bytes = "OPSN";
+	put_le<std::uint16_t>(bytes, 1);
+	put_le<std::uint16_t>(bytes, 0x0102);
+	for (const std::uint32_t field : {2u, 1u, 1u, 0u, 7u, 0u})
+		put_le(bytes, field);
+	// jobs: integer, seen once, "4" at pool offset 0.
+	for (const std::uint32_t field : {2u, 1u, 0u, 0u, 1u, 0u})
+		put_le(bytes, field);
+	put_le<std::int64_t>(bytes, 4);
+	put_le<double>(bytes, 0.0);
+	// include: list, one value at list offset 0.
+	for (const std::uint32_t field : {5u, 1u, 1u, 0u, 0u, 0u})
+		put_le(bytes, field);
+	put_le<std::int64_t>(bytes, 0);
+	put_le<double>(bytes, 0.0);
+	// Positional "pos" and list value "inc".
+	for (const std::uint32_t field : {1u, 3u, 4u, 3u})
+		put_le(bytes, field);
+	bytes += "4posinc";
+
+	const result restored = restore_snapshot(options, bytes);
+	EXPECT_EQ(restored.get<std::int64_t>(jobs), 4);
+	EXPECT_EQ(*restored.get<string_span>(include).begin(), "inc");
+	EXPECT_EQ(restored.positionals(), (std::vector<std::string_view>{"pos"}));
+}
+
+TEST(SnapshotTest, OlderSpecPrefixRestoresWithDefaults) {
+	spec old_options;
+	const option_id jobs = old_options.add_int("jobs", 'j');
+	const std::vector<std::string_view> args{"-j", "6"};
+	const std::string bytes = save_snapshot(parse(old_options, arg_list(args)));
+
+	spec new_options;
+	new_options.add_int("jobs", 'j');
+	const option_id tags = new_options.add_list("tag", 't');
+	const option_id mode = new_options.add_string("mode", 'm', "fast");
+	const result restored = restore_snapshot(new_options, bytes);
+	EXPECT_EQ(restored.get<std::int64_t>(jobs), 6);
+	EXPECT_EQ(restored.get<string_span>(tags).size(), 0u);
+	EXPECT_EQ(restored.get<std::string_view>(mode), "fast");
+
+	// The other way round, or with a changed kind, the spec is not compatible.
+	EXPECT_THROW(restore_snapshot(spec(), bytes), std::invalid_argument);
+	spec changed;
+	changed.add_string("jobs", 'j');
+	EXPECT_THROW(restore_snapshot(changed, bytes), std::invalid_argument);
+}
+
+TEST(SnapshotTest, RejectsNewerVersionsAndDamage) {
+	every_kind_spec s;
+	const std::vector<std::string_view> args{"-I", "a", "-l", "k=v", "pos"};
+	const std::string bytes = save_snapshot(parse(s.options, arg_list(args)));
+	EXPECT_NO_THROW(restore_snapshot(s.options, bytes));
+
+	std::string newer = bytes;
+	const std::uint16_t version = snapshot_version + 1;
+	std::memcpy(&newer[4], &version, sizeof version);
+	EXPECT_THROW(restore_snapshot(s.options, newer), std::invalid_argument);
+
+	EXPECT_THROW(restore_snapshot(s.options, "OPSN"), std::invalid_argument);
+	EXPECT_THROW(restore_snapshot(s.options, bytes.substr(0, bytes.size() - 1)), std::invalid_argument);
+	EXPECT_THROW(restore_snapshot(s.options, bytes + "x"), std::invalid_argument);
+
+	// Every single corrupted byte is either rejected or restores safely.
+	for (std::size_t i = 0; i < bytes.size(); ++i) {
+		std::string damaged = bytes;
+		damaged[i] = static_cast<char>(damaged[i] ^ 0x80);
+		try {
+			restore_snapshot(s.options, damaged);
+		} catch (const std::invalid_argument &) {
+		}
+	}
+}
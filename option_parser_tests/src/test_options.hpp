@@ -0,0 +1,28 @@
+#pragma once
+
+#include "option_parser/option_parser.hpp"
+
+namespace option_parser_test {
+
+enum class level { low, mid, high };
+
+constexpr auto levels = option_parser::make_choices<level>(
+    {{"low", level::low}, {"mid", level::mid}, {"high", level::high}});
+
+// A sealed spec with one option of every kind, for tests that need to cover
+// them all (snapshots, concurrent parsing).
+struct every_kind_spec {
+	option_parser::spec options;
+	option_parser::option_id verbose = options.add_flag("verbose", 'v');
+	option_parser::option_id jobs = options.add_int("jobs", 'j', 1);
+	option_parser::option_id ratio = options.add_double("ratio", 'r', 0.5);
+	option_parser::option_id name = options.add_string("name", 'n', "worker");
+	option_parser::option_id priority =
+	    options.add_choice("priority", 'p', levels, level::low, option_parser::choice_match::ignore_case);
+	option_parser::option_id include = options.add_list("include", 'I');
+	option_parser::option_id label = options.add_map("label", 'l', ',');
+
+	every_kind_spec() { options.seal(); }
+};
+
+} // namespace option_parser_test
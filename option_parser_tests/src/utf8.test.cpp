@@ -0,0 +1,212 @@
+#include <gtest/gtest.h>
+
+#include "option_parser/option_parser.hpp"
+#include "option_parser/utf8.hpp"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace option_parser;
+
+namespace {
+
+constexpr std::size_t npos = std::string_view::npos;
+
+// Straightforward decoder to check the validator against: decodes each
+// sequence in full and checks the code point it yields.
+std::size_t reference_invalid(std::string_view text) {
+	std::size_t i = 0;
+	while (i < text.size()) {
+		const auto lead = static_cast<unsigned char>(text[i]);
+		std::size_t length = 0;
+		std::uint32_t cp = 0;
+		if (lead < 0x80) {
+			length = 1;
+			cp = lead;
+		} else if ((lead & 0xe0) == 0xc0) {
+			length = 2;
+			cp = lead & 0x1f;
+		} else if ((lead & 0xf0) == 0xe0) {
+			length = 3;
+			cp = lead & 0x0f;
+		} else if ((lead & 0xf8) == 0xf0) {
+			length = 4;
+			cp = lead & 0x07;
+		} else {
+			return i;
+		}
+		if (text.size() - i < length)
+			return i;
+		for (std::size_t k = 1; k < length; ++k) {
+			const auto byte = static_cast<unsigned char>(text[i + k]);
+			if ((byte & 0xc0) != 0x80)
+				return i;
+			cp = cp << 6 | (byte & 0x3f);
+		}
+		const std::uint32_t min[] = {0, 0, 0x80, 0x800, 0x10000};
+		if (cp < min[length] || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+			return i;
+		i += length;
+	}
+	return npos;
+}
+
+std::string encode(std::uint32_t cp) {
+	std::string out;
+	if (cp < 0x80) {
+		out += static_cast<char>(cp);
+	} else if (cp < 0x800) {
+		out += static_cast<char>(0xc0 | cp >> 6);
+		out += static_cast<char>(0x80 | (cp & 0x3f));
+	} else if (cp < 0x10000) {
+		out += static_cast<char>(0xe0 | cp >> 12);
+		out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+		out += static_cast<char>(0x80 | (cp & 0x3f));
+	} else {
+		out += static_cast<char>(0xf0 | cp >> 18);
+		out += static_cast<char>(0x80 | (cp >> 12 & 0x3f));
+		out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+		out += static_cast<char>(0x80 | (cp & 0x3f));
+	}
+	return out;
+}
+
+} // namespace
+
+TEST(Utf8Test, AcceptsEveryScalarValue) {
+	for (std::uint32_t cp = 0; cp <= 0x10ffff; ++cp) {
+		if (cp >= 0xd800 && cp <= 0xdfff)
+			continue;
+		ASSERT_TRUE(is_valid_utf8(encode(cp))) << std::hex << cp;
+	}
+	EXPECT_TRUE(is_valid_utf8(""));
+	EXPECT_TRUE(is_valid_utf8("/srv/données/日本語/файл-😀.txt"));
+}
+
+TEST(Utf8Test, RejectsMalformedSequences) {
+	const std::vector<std::pair<std::string, std::size_t>> cases{
+	    {"\x80", 0},                 // lone continuation
+	    {"a\xbf", 1},                //
+	    {"\xc0\x80", 0},             // overlong NUL
+	    {"\xc1\xbf", 0},             // overlong U+007F
+	    {"\xe0\x80\x80", 0},         // overlong in three bytes
+	    {"\xe0\x9f\xbf", 0},         // overlong U+07FF
+	    {"\xf0\x80\x80\x80", 0},     // overlong in four bytes
+	    {"\xf0\x8f\xbf\xbf", 0},     // overlong U+FFFF
+	    {"\xed\xa0\x80", 0},         // surrogate U+D800
+	    {"\xed\xbf\xbf", 0},         // surrogate U+DFFF
+	    {"\xf4\x90\x80\x80", 0},     // U+110000
+	    {"\xf5\x80\x80\x80", 0},     // lead past U+10FFFF
+	    {"\xff", 0},                 //
+	    {"\xfe\xfe\xff\xff", 0},     //
+	    {"ab\xc3", 2},               // truncated at the end
+	    {"\xe2\x82", 0},             //
+	    {"\xf0\x9f\x98", 0},         //
+	    {"\xe2\x82x", 0},            // truncated by ASCII
+	    {"\xc3\xa9\xc3(", 2},        // second sequence bad
+	    {"\xf0\x9f\x98\x80\x80", 4}, // extra continuation
+	};
+	for (const auto &[text, offset] : cases) {
+		EXPECT_EQ(find_invalid_utf8(text), offset) << ::testing::PrintToString(text);
+		EXPECT_EQ(reference_invalid(text), offset) << ::testing::PrintToString(text);
+	}
+}
+
+// Every one and two byte string and every three byte string with a
+// non-ASCII lead, against the reference decoder.
+TEST(Utf8Test, AgreesWithReferenceOnShortStrings) {
+	std::string text(3, '\0');
+	for (int a = 0; a < 256; ++a) {
+		text.resize(1);
+		text[0] = static_cast<char>(a);
+		ASSERT_EQ(find_invalid_utf8(text), reference_invalid(text));
+		for (int b = 0; b < 256; ++b) {
+			text.resize(2);
+			text[1] = static_cast<char>(b);
+			ASSERT_EQ(find_invalid_utf8(text), reference_invalid(text));
+			if (a < 0x80)
+				continue;
+			text.resize(3);
+			for (int c = 0; c < 256; ++c) {
+				text[2] = static_cast<char>(c);
+				ASSERT_EQ(find_invalid_utf8(text), reference_invalid(text)) << a << ' ' << b << ' ' << c;
+			}
+		}
+	}
+}
+
+// Bad bytes at every position around and across the eight byte words of
+// the ASCII fast path, in random mixed text.
+TEST(Utf8Test, AgreesWithReferenceAcrossWordBoundaries) {
+	for (std::size_t length = 0; length < 40; ++length) {
+		for (std::size_t pos = 0; pos < length; ++pos) {
+			std::string text(length, 'a');
+			text[pos] = '\x80';
+			EXPECT_EQ(find_invalid_utf8(text), pos);
+			if (pos + 2 <= length) {
+				text.replace(pos, 2, "\xc3\xa9");
+				EXPECT_EQ(find_invalid_utf8(text), npos);
+			}
+		}
+	}
+
+	std::mt19937 random(43);
+	const std::vector<std::string> pieces{"a", "path/", "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x98\x80", "\xed\xa0\x80",
+	                                      "\xc3", "\x80", "\xf4\x90\x80\x80", "0123456789abcdef"};
+	std::uniform_int_distribution<std::size_t> pick(0, pieces.size() - 1);
+	for (int i = 0; i < 20000; ++i) {
+		std::string text;
+		for (int n = static_cast<int>(random() % 12); n > 0; --n)
+			text += pieces[pick(random)];
+		ASSERT_EQ(find_invalid_utf8(text), reference_invalid(text)) << ::testing::PrintToString(text);
+	}
+}
+
+TEST(Utf8OptionTest, RequiredUtf8RejectsBadArguments) {
+	spec options;
+	const option_id label = options.add_string("étiquette", 'l');
+	options.add_flag("verbose", 'v');
+	options.require_utf8();
+
+	const std::vector<std::string_view> good{"--étiquette=日本語", "données.txt"};
+	const result parsed = parse(options, arg_list(good));
+	EXPECT_EQ(parsed.get<std::string_view>(label), "日本語");
+
+	const auto error_of = [&](std::vector<std::string_view> args) {
+		try {
+			parse(options, arg_list(args));
+		} catch (const parse_error &e) {
+			EXPECT_EQ(e.code(), error_code::invalid_encoding);
+			return e.index();
+		}
+		ADD_FAILURE() << "expected a parse_error";
+		return npos;
+	};
+	EXPECT_EQ(error_of({"-v", "file\xff"}), 1u);
+	EXPECT_EQ(error_of({"-l", "\xed\xa0\x80"}), 1u);
+	EXPECT_EQ(error_of({"--", "a", "\xc3"}), 2u);
+	try {
+		parse(options, arg_list(std::vector<std::string_view>{"-v\xc3\xa9"}));
+		ADD_FAILURE() << "expected a parse_error";
+	} catch (const parse_error &e) {
+		EXPECT_EQ(e.code(), error_code::unknown_option) << "valid UTF-8, but no such option";
+	}
+
+	// Unchecked specs keep arguments as bytes.
+	options = spec();
+	options.add_string("label", 'l');
+	EXPECT_EQ(parse(options, arg_list(std::vector<std::string_view>{"-l", "\xff"})).get<std::string_view>("label"),
+	          "\xff");
+}
+
+TEST(Utf8OptionTest, NamesMustBeValid) {
+	spec options;
+	EXPECT_THROW(options.add_flag("bad\xff"), std::invalid_argument);
+	EXPECT_THROW(options.add_flag("x", '\xc3'), std::invalid_argument);
+	const option_id size = options.add_string("größe");
+	EXPECT_THROW(options.add_alias(size, "gr\xc3", '\0'), std::invalid_argument);
+	options.seal();
+	EXPECT_THROW(options.require_utf8(), std::logic_error);
+}